@@ -14,6 +14,9 @@ struct AppData {
   static let syncTimeInterval: Double = 0.1
   static let syncTimePreciseInterval: Double = 0.04
 
+  /** time the mouse has to stay between two thumbnails before more thumbnails are generated there */
+  static let thumbnailRefinementDelay: Double = 0.5
+
   /** speed values when clicking left / right arrow button */
 
 //  static let availableSpeedValues: [Double] = [-32, -16, -8, -4, -2, -1, 1, 2, 4, 8, 16, 32]
@@ -49,6 +52,7 @@ struct AppData {
   static let historyFile = "history.plist"
   static let thumbnailCacheFolder = "thumb_cache"
   static let screenshotCacheFolder = "screenshot_cache"
+  static let mediaInfoCacheFile = "media_info_cache"
 
   static let githubLink = "https://github.com/iina/iina"
   static let contributorsLink = "https://github.com/iina/iina/graphs/contributors"
@@ -129,6 +133,7 @@ struct Constants {
 extension Notification.Name {
   static let iinaMainWindowChanged = Notification.Name("IINAMainWindowChanged")
   static let iinaPlaylistChanged = Notification.Name("IINAPlaylistChanged")
+  static let iinaPlaylistVideoInfoProbed = Notification.Name("IINAPlaylistVideoInfoProbed")
   static let iinaTracklistChanged = Notification.Name("IINATracklistChanged")
   static let iinaVIDChanged = Notification.Name("iinaVIDChanged")
   static let iinaAIDChanged = Notification.Name("iinaAIDChanged")
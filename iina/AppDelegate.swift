@@ -688,6 +688,7 @@ class AppDelegate: NSObject, NSApplicationDelegate, SPUUpdaterDelegate {
 
   func applicationWillTerminate(_ notification: Notification) {
     Logger.log("App will terminate")
+    MediaInfoCache.shared.synchronize()
     Logger.closeLogFile()
   }
 
@@ -115,33 +115,30 @@ class AutoFileMatcher {
   }
 
   private func addFilesToPlaylist() throws {
-    var addedCurrentVideo = false
-    var needQuit = false
-
     log("Adding files to playlist")
-    // add videos
+    let startTime = Date()
+    // Files before the current video are inserted before it, the others are appended
+    var filesBefore: [String] = []
+    var filesAfter: [String] = []
+    var addedCurrentVideo = false
     for video in filesGroupedByMediaType[.video]! + filesGroupedByMediaType[.audio]! {
-      // add to playlist
       if video.url.path == player.info.currentURL?.path {
         addedCurrentVideo = true
       } else if addedCurrentVideo {
-        try checkTicket()
-        player.addToPlaylist(video.path, silent: true)
+        filesAfter.append(video.path)
       } else {
-        let count = player.mpv.getInt(MPVProperty.playlistCount)
-        let current = player.mpv.getInt(MPVProperty.playlistPos)
-        try checkTicket()
-        player.addToPlaylist(video.path, silent: true)
-        player.mpv.command(.playlistMove, args: ["\(count)", "\(current)"], checkError: false,
-                           level: .verbose) { err in
-          if err == MPV_ERROR_COMMAND.rawValue { needQuit = true }
-          if err != 0 {
-            self.log("Error \(err) when adding files to playlist", level: .error)
-          }
-        }
+        filesBefore.append(video.path)
       }
-      if needQuit { break }
     }
+    try checkTicket()
+    let current = player.mpv.getInt(MPVProperty.playlistPos)
+    var failedCount = player.addToPlaylist(batch: filesBefore, insertingAt: current >= 0 ? current : nil)
+    try checkTicket()
+    failedCount += player.addToPlaylist(batch: filesAfter, insertingAt: nil)
+    if failedCount > 0 {
+      log("Error adding \(failedCount) files to playlist", level: .error)
+    }
+    log("Added \(filesBefore.count + filesAfter.count) files to playlist, took \(String(format: "%.2f", Date().timeIntervalSince(startTime) * 1000))ms")
   }
 
   private func matchVideoAndSubSeries() throws -> [String: String] {
@@ -8,57 +8,258 @@
 
 import Cocoa
 
+fileprivate let subsystem = Logger.makeSubsystem("cachemgr")
+
+/// Keeps track of the size and last access of the files in the thumbnail cache and removes the least recently used files when the
+/// cache grows too large.
+///
+/// The index is kept in memory and persisted to a journal in the cache folder, so the size of the cache is known without listing the
+/// folder and reading the attributes of every file. Records are appended to the journal as files are written, read and removed:
+/// ```
+/// [version]
+/// [operation][last access][size][name length][name] × records
+/// ```
+/// All values are in native byte order. The folder is only listed when there is no usable journal, such as for a cache written by an
+/// older version. All methods may be called from any thread, the index is only accessed on `queue`.
 class CacheManager {
 
   static var shared = CacheManager()
 
-  var isJobRunning = false
-  var needsRefresh = true
+  private typealias JournalVersion = UInt8
+  private typealias Operation = UInt8
+  private typealias EntrySize = Int64
+  private typealias NameLength = UInt16
 
-  private var cachedContents: [URL]?
+  private static let journalVersion: JournalVersion = 1
+  private static let journalName = ".index"
+  private static let updateOperation: Operation = 1
+  private static let removeOperation: Operation = 2
 
-  private func cacheFolderContents() -> [URL]? {
-    if needsRefresh {
-      cachedContents = try? FileManager.default.contentsOfDirectory(at: Utility.thumbnailCacheURL,
-                                                                    includingPropertiesForKeys: [.fileSizeKey, .contentAccessDateKey],
-                                                                    options: [.skipsHiddenFiles, .skipsSubdirectoryDescendants])
-    }
-    return cachedContents
+  /// Minimum number of journal records before the journal is rewritten to drop outdated records.
+  private static let compactionThreshold = 1000
+
+  /// When the cache grows above its maximum size the least recently used files are removed until it is below this fraction of the
+  /// maximum size.
+  private static let lowWatermark = 0.5
+
+  private struct Entry {
+    var size: Int
+    var lastAccess: TimeInterval
+  }
+
+  private let queue = DispatchQueue(label: "IINACacheManager", qos: .utility)
+
+  // The following state is only accessed on `queue`.
+  private var entries: [String: Entry] = [:]
+  private var totalSize = 0
+  private var loaded = false
+  private var journalRecordCount = 0
+  private var isEvicting = false
+
+  private var journalURL: URL {
+    Utility.thumbnailCacheURL.appendingPathComponent(CacheManager.journalName, isDirectory: false)
+  }
+
+  private func log(_ message: String, level: Logger.Level = .debug) {
+    Logger.log(message, level: level, subsystem: subsystem)
   }
 
+  /// Returns the total size of the files in the cache.
   func getCacheSize() -> Int {
-    return cacheFolderContents()?.reduce(0 as Int) { totalSize, url in
-      let size = (try? url.resourceValues(forKeys: [.fileSizeKey]))?.fileSize ?? 0
-      return totalSize + size
-    } ?? 0
+    queue.sync {
+      loadIfNeeded()
+      return totalSize
+    }
+  }
+
+  /// Returns the number of files in the cache.
+  func getEntryCount() -> Int {
+    queue.sync {
+      loadIfNeeded()
+      return entries.count
+    }
   }
 
+  /// Record that the given cache file has been written and remove old files in the background if the cache is now too large.
+  func didWrite(_ url: URL, size: Int) {
+    let now = Date().timeIntervalSince1970
+    queue.async { [self] in
+      loadIfNeeded()
+      update(url.lastPathComponent, Entry(size: size, lastAccess: now))
+      evictIfNeeded()
+    }
+  }
+
+  /// Record that the given cache file has been read, making it the most recently used one.
+  func didAccess(_ url: URL) {
+    let now = Date().timeIntervalSince1970
+    queue.async { [self] in
+      loadIfNeeded()
+      guard var entry = entries[url.lastPathComponent] else { return }
+      entry.lastAccess = now
+      update(url.lastPathComponent, entry)
+    }
+  }
+
+  /// Record that the given cache file has been removed.
+  func didRemove(_ url: URL) {
+    queue.async { [self] in
+      loadIfNeeded()
+      remove(url.lastPathComponent)
+    }
+  }
+
+  /// Remove the least recently used files in the background if the cache is larger than allowed.
   func clearOldCache() {
-    guard !isJobRunning else { return }
-    isJobRunning = true
-
-    let maxCacheSize = Preference.integer(for: .maxThumbnailPreviewCacheSize)
-    // if full, delete 50% of max cache
-    let cacheToDelete = maxCacheSize * FloatingPointByteCountFormatter.PrefixFactor.mi.rawValue / 2
-
-    // sort by access date
-    guard let contents = cacheFolderContents()?.sorted(by: { url1, url2 in
-      let date1 = (try? url1.resourceValues(forKeys: [.contentAccessDateKey]).contentAccessDate) ?? Date.distantPast
-      let date2 = (try? url2.resourceValues(forKeys: [.contentAccessDateKey]).contentAccessDate) ?? Date.distantPast
-      return date1.compare(date2) == .orderedAscending
-    }) else { return }
-
-    // delete old cache
-    var clearedCacheSize = 0
-    for url in contents {
-      let size = (try? url.resourceValues(forKeys: [.fileSizeKey]))?.fileSize ?? 0
-      if clearedCacheSize < cacheToDelete {
-        try? FileManager.default.removeItem(at: url)
-        clearedCacheSize += size
+    queue.async { [self] in
+      loadIfNeeded()
+      evictIfNeeded()
+    }
+  }
+
+  /// Forget the index, to be called after the cache folder has been removed.
+  func reset() {
+    queue.sync {
+      entries.removeAll()
+      totalSize = 0
+      journalRecordCount = 0
+      loaded = false
+    }
+  }
+
+  // MARK: - Private
+
+  private func update(_ name: String, _ entry: Entry) {
+    totalSize += entry.size - (entries[name]?.size ?? 0)
+    entries[name] = entry
+    appendToJournal(CacheManager.record(CacheManager.updateOperation, name, entry))
+  }
+
+  private func remove(_ name: String) {
+    guard let entry = entries.removeValue(forKey: name) else { return }
+    totalSize -= entry.size
+    appendToJournal(CacheManager.record(CacheManager.removeOperation, name, entry))
+  }
+
+  /// Remove the least recently used files until the cache is below the low watermark. The files are sorted by last access only
+  /// when the cache is too large, which happens rarely.
+  private func evictIfNeeded() {
+    let maxCacheSize = Preference.integer(for: .maxThumbnailPreviewCacheSize) * FloatingPointByteCountFormatter.PrefixFactor.mi.rawValue
+    guard maxCacheSize > 0, totalSize > maxCacheSize, !isEvicting else { return }
+    isEvicting = true
+    defer { isEvicting = false }
+    let startTime = CACurrentMediaTime()
+    let target = Int(Double(maxCacheSize) * CacheManager.lowWatermark)
+    var removedCount = 0
+    for (name, _) in entries.sorted(by: { $0.value.lastAccess < $1.value.lastAccess }) {
+      guard totalSize > target else { break }
+      let url = Utility.thumbnailCacheURL.appendingPathComponent(name)
+      do {
+        try FileManager.default.removeItem(at: url)
+      } catch CocoaError.fileNoSuchFile {
+        // Already removed by someone else, the index is corrected below
+      } catch {
+        log("Cannot remove \(name): \(error)", level: .error)
+        continue
+      }
+      remove(name)
+      removedCount += 1
+    }
+    log("Removed \(removedCount) old cache files, took \(String(format: "%.2f", (CACurrentMediaTime() - startTime) * 1000))ms")
+  }
+
+  private func loadIfNeeded() {
+    guard !loaded else { return }
+    loaded = true
+    let startTime = CACurrentMediaTime()
+    if !readJournal() {
+      rebuildIndex()
+    }
+    log("Loaded cache index with \(entries.count) files, took \(String(format: "%.2f", (CACurrentMediaTime() - startTime) * 1000))ms")
+    if journalRecordCount > CacheManager.compactionThreshold && journalRecordCount > 2 * entries.count {
+      writeJournal()
+    }
+  }
+
+  /// Replay the journal.
+  /// - Returns: `false` if there is no usable journal.
+  private func readJournal() -> Bool {
+    guard let data = try? Data(contentsOf: journalURL, options: .alwaysMapped),
+          data.read(type: JournalVersion.self, at: 0) == CacheManager.journalVersion else { return false }
+    let sizeofHeader = MemoryLayout<Operation>.size + MemoryLayout<TimeInterval>.size + MemoryLayout<EntrySize>.size +
+      MemoryLayout<NameLength>.size
+    var offset = MemoryLayout<JournalVersion>.size
+    // A record cut short by an interruption ends the journal, it is rewritten below
+    while let operation = data.read(type: Operation.self, at: offset),
+          let lastAccess = data.read(type: TimeInterval.self, at: offset + MemoryLayout<Operation>.size),
+          let size = data.read(type: EntrySize.self, at: offset + MemoryLayout<Operation>.size + MemoryLayout<TimeInterval>.size),
+          let length = data.read(type: NameLength.self, at: offset + sizeofHeader - MemoryLayout<NameLength>.size),
+          offset + sizeofHeader + Int(length) <= data.count {
+      let name = String(decoding: data.subdata(in: offset + sizeofHeader..<offset + sizeofHeader + Int(length)), as: UTF8.self)
+      offset += sizeofHeader + Int(length)
+      journalRecordCount += 1
+      if operation == CacheManager.removeOperation {
+        totalSize -= entries.removeValue(forKey: name)?.size ?? 0
       } else {
-        break
+        totalSize += Int(size) - (entries[name]?.size ?? 0)
+        entries[name] = Entry(size: Int(size), lastAccess: lastAccess)
       }
     }
+    if offset != data.count {
+      writeJournal()
+    }
+    return true
+  }
+
+  /// Build the index from the contents of the cache folder and write a new journal.
+  private func rebuildIndex() {
+    log("Building cache index from the contents of the cache folder")
+    let contents = (try? FileManager.default.contentsOfDirectory(at: Utility.thumbnailCacheURL,
+                                                                  includingPropertiesForKeys: [.fileSizeKey, .contentAccessDateKey],
+                                                                  options: [.skipsHiddenFiles, .skipsSubdirectoryDescendants])) ?? []
+    for url in contents {
+      let values = try? url.resourceValues(forKeys: [.fileSizeKey, .contentAccessDateKey])
+      let entry = Entry(size: values?.fileSize ?? 0,
+                        lastAccess: values?.contentAccessDate?.timeIntervalSince1970 ?? 0)
+      entries[url.lastPathComponent] = entry
+      totalSize += entry.size
+    }
+    writeJournal()
+  }
+
+  /// Replace the journal with one holding a record for every file in the index.
+  private func writeJournal() {
+    var data = Data(bytesOf: CacheManager.journalVersion)
+    for (name, entry) in entries {
+      data.append(CacheManager.record(CacheManager.updateOperation, name, entry))
+    }
+    do {
+      try data.write(to: journalURL, options: .atomic)
+      journalRecordCount = entries.count
+    } catch {
+      log("Cannot write cache index: \(error)", level: .error)
+    }
   }
 
+  private func appendToJournal(_ record: Data) {
+    guard let file = try? FileHandle(forWritingTo: journalURL) else {
+      // The journal is gone, such as after the cache has been cleared
+      writeJournal()
+      return
+    }
+    defer { file.closeFile() }
+    file.seekToEndOfFile()
+    file.write(record)
+    journalRecordCount += 1
+  }
+
+  private static func record(_ operation: Operation, _ name: String, _ entry: Entry) -> Data {
+    let nameData = Data(name.utf8)
+    var data = Data(bytesOf: operation)
+    data.append(Data(bytesOf: entry.lastAccess))
+    data.append(Data(bytesOf: EntrySize(entry.size)))
+    data.append(Data(bytesOf: NameLength(nameData.count)))
+    data.append(nameData)
+    return data
+  }
 }
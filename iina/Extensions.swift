@@ -448,6 +448,16 @@ extension Data {
     self.init(bytes: &copyOfThing, count: MemoryLayout.size(ofValue: thing))
   }
   
+  func read<T>(type: T.Type /* To prevent unintended specializations */, at offset: Int) -> T? {
+    let size = MemoryLayout<T>.size
+    guard offset >= 0, offset + size <= count else {
+      return nil
+    }
+    return subdata(in: offset..<offset + size).withUnsafeBytes {
+      $0.bindMemory(to: T.self).first!
+    }
+  }
+
   func saveToFolder(_ url: URL, filename: String) -> URL? {
     let fileUrl = url.appendingPathComponent(filename)
     do {
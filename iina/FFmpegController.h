@@ -7,28 +7,95 @@
 //
 
 #import <Foundation/Foundation.h>
+#import <CoreGraphics/CoreGraphics.h>
+
+
+/// Pixel storage shared by all thumbnails of a video.
+///
+/// The thumbnails are stored as 8 bit RGBA bitmaps of the same size in one contiguous allocation. The scaler writes directly into
+/// this buffer and `FFThumbnail` wraps a slot of it in an image only when one is requested.
+@interface FFThumbnailBuffer: NSObject
+
+@property(nonatomic, readonly) int width;
+@property(nonatomic, readonly) int height;
+@property(nonatomic, readonly) size_t bytesPerRow;
+@property(nonatomic, readonly) NSInteger capacity;
+
+- (nonnull instancetype)initWithWidth:(int)width height:(int)height capacity:(NSInteger)capacity;
+
+/// Returns the pixels of the slot at the given index.
+- (nonnull uint8_t *)pixelsAtIndex:(NSInteger)index NS_RETURNS_INNER_POINTER;
+
+@end
 
 
 @interface FFThumbnail: NSObject
 
+/// The thumbnail image.
+///
+/// For thumbnails backed by a `FFThumbnailBuffer` the image is created on first access and references the pixels in the buffer.
 @property(nonatomic) NSImage * _Nullable image;
 @property(nonatomic) double realTime;
 
+@property(nonatomic, readonly) FFThumbnailBuffer * _Nullable buffer;
+@property(nonatomic, readonly) NSInteger bufferIndex;
+
+- (nonnull instancetype)initWithBuffer:(nonnull FFThumbnailBuffer *)buffer index:(NSInteger)index realTime:(double)realTime;
+
+/// Returns an image of the thumbnail without going through `NSImage`.
+- (nullable CGImageRef)createCGImage CF_RETURNS_RETAINED;
+
+@end
+
+
+/// Results of an interrupted thumbnail job, used to resume the job instead of starting over.
+@interface FFThumbnailResumeState: NSObject
+
+/// The number of intervals the timeline was divided into, see `FFmpegController.thumbnailCount`.
+@property(nonatomic) NSInteger thumbnailCount;
+
+/// The preview points that were processed, whether or not they produced a thumbnail.
+@property(nonatomic, nonnull) NSIndexSet *processedPoints;
+
+/// The thumbnails of the processed preview points that produced one, keyed by preview point.
+@property(nonatomic, nonnull) NSDictionary<NSNumber *, FFThumbnail *> *thumbnails;
+
 @end
 
 
 @protocol FFmpegControllerDelegate <NSObject>
 
 /**
- A notification being sent
+ A notification being sent. `thumbnailCount` is the number of intervals of the job the progress belongs to, which differs from
+ `FFmpegController.thumbnailCount` when `thumbnailAdaptiveDensity` is enabled.
  */
-- (void)didUpdateThumbnails:(nullable NSArray<FFThumbnail *> *)thumbnails forFile:(nonnull NSString *)filename withProgress:(NSInteger)progress;
+- (void)didUpdateThumbnails:(nullable NSArray<FFThumbnail *> *)thumbnails
+                    forFile:(nonnull NSString *)filename
+               withProgress:(NSInteger)progress
+             thumbnailCount:(NSInteger)thumbnailCount;
 
 /**
  Did generated thumbnails for the video.
  */
 - (void)didGenerateThumbnails:(nonnull NSArray<FFThumbnail *> *)thumbnails forFile:(nonnull NSString *)filename succeeded:(BOOL)succeeded;
 
+@optional
+
+/**
+ Preview points have been processed since the last call. Sent before every update notification and before the thumbnails are
+ generated, so the results can be saved and used to resume an interrupted job. Preview points restored from a resume state
+ are not reported again. `thumbnailCount` is the number of intervals of the job the preview points belong to.
+ */
+- (void)didProcessThumbnailPoints:(nonnull NSIndexSet *)points
+                       thumbnails:(nonnull NSDictionary<NSNumber *, FFThumbnail *> *)thumbnails
+                   thumbnailCount:(NSInteger)thumbnailCount
+                          forFile:(nonnull NSString *)filename;
+
+/**
+ Did generate additional thumbnails for a part of the video, see `refineThumbnailsForFile:thumbWidth:fromTime:toTime:`.
+ */
+- (void)didRefineThumbnails:(nonnull NSArray<FFThumbnail *> *)thumbnails forFile:(nonnull NSString *)filename;
+
 @end
 
 
@@ -36,8 +103,80 @@
 
 @property(nonatomic, weak) id<FFmpegControllerDelegate> _Nullable delegate;
 
+/// Number of intervals the timeline is divided into, there is a preview point at the start of every interval and at the end.
 @property(nonatomic) NSInteger thumbnailCount;
 
+/// Whether the number of intervals is chosen for every video instead of being `thumbnailCount`.
+///
+/// When enabled every job chooses its number of intervals from the duration of the video, `thumbnailSeekBarWidth` and the keyframe
+/// rate of the video, which is used as an estimate of its scene change rate. `thumbnailCount` is left unchanged and used when the
+/// number cannot be chosen.
+@property(nonatomic) BOOL thumbnailAdaptiveDensity;
+
+/// Width of the seek bar in points, `0` if unknown. Used by `thumbnailAdaptiveDensity`.
+@property(nonatomic) NSInteger thumbnailSeekBarWidth;
+
+/// Number of intervals the part of the timeline passed to `refineThumbnailsForFile:thumbWidth:fromTime:toTime:` is divided into.
+@property(nonatomic) NSInteger thumbnailRefinementCount;
+
+/// Number of workers used to generate thumbnails.
+///
+/// The timeline is split into this many contiguous segments, each decoded by a worker with its own demuxer and decoder. Thumbnails
+/// are still passed to the delegate in timeline order. A value of `1` generates thumbnails serially, a value of `0` or less selects
+/// the number of workers based on the number of processor cores.
+@property(nonatomic) NSInteger thumbnailWorkerCount;
+
+/// Whether thumbnails are only generated from keyframes.
+///
+/// When enabled only the keyframe nearest to each preview point is decoded, instead of decoding from that keyframe up to the first
+/// frame the decoder outputs. The time of the keyframe is stored in `FFThumbnail.realTime`.
+@property(nonatomic) BOOL thumbnailKeyframesOnly;
+
+/// Whether the decoder may trade quality for speed when generating thumbnails.
+///
+/// When enabled the decoder skips work whose result is lost when the frame is scaled down to the thumbnail size, such as the loop
+/// filter, and decodes at a reduced resolution if the codec supports it. The settings are chosen from the ratio of the video width to
+/// the thumbnail width.
+@property(nonatomic) BOOL thumbnailFastDecoding;
+
+/// Number of threads each thumbnail decoder may use.
+///
+/// A value of `0` or less divides the processor cores between the workers, a value of `1` disables threading.
+@property(nonatomic) NSInteger thumbnailDecoderThreadCount;
+
+/// Whether the thumbnail decoder may use frame threading in addition to slice threading.
+///
+/// Frame threading delays the output of the first frame after every seek by one frame per thread, so it is disabled by default.
+@property(nonatomic) BOOL thumbnailFrameThreading;
+
+/// Whether thumbnails are generated coarse to fine instead of from start to end.
+///
+/// In progressive order every segment is first sampled at a large interval that is then repeatedly halved, so partial results cover
+/// the whole timeline early. Partial results are passed to the delegate in the order they are generated, the progress is then the
+/// number of processed preview points. The final result is in timeline order.
+@property(nonatomic) BOOL thumbnailProgressiveOrder;
+
+/// Whether blank and duplicate frames are avoided when generating thumbnails.
+///
+/// When enabled and the frame at a preview point is blank, such as a black frame or a fade, or looks like the thumbnail of a
+/// neighbouring preview point, a few of the following frames are scored and the best one is used. The time of the frame used
+/// is stored in `FFThumbnail.realTime`. Not used in keyframe only mode.
+@property(nonatomic) BOOL thumbnailSceneAware;
+
+/// Whether thumbnails are generated with few bounded reads, for streams and files on network volumes.
+///
+/// In network mode only the keyframe nearest to each preview point is read, as in `thumbnailKeyframesOnly`, preview points sharing
+/// a keyframe share its thumbnail, and the preview points are processed from start to end so reads move forward through the file.
+/// Reads are issued in large blocks and throttled to `thumbnailNetworkByteRate`. The number of workers, each with its own
+/// connection, is limited to `thumbnailNetworkConnectionCount`. The number of bytes read is logged for every job.
+@property(nonatomic) BOOL thumbnailNetworkMode;
+
+/// Maximum number of connections used to read the file in network mode.
+@property(nonatomic) NSInteger thumbnailNetworkConnectionCount;
+
+/// Maximum number of bytes read per second in network mode, `0` for no limit.
+@property(nonatomic) NSInteger thumbnailNetworkByteRate;
+
 /// Initializes and returns an image object with the contents of the specified URL
 ///
 /// At this time, the normal [NSImage](https://developer.apple.com/documentation/appkit/nsimage/1519907-init)
@@ -56,6 +195,31 @@
 - (void)generateThumbnailForFile:(nonnull NSString *)file
                       thumbWidth:(int)thumbWidth;
 
+/// Generates thumbnails, skipping the preview points processed by an interrupted job.
+///
+/// The resume state is ignored if it was created with a different number of intervals than the job uses.
+- (void)generateThumbnailForFile:(nonnull NSString *)file
+                      thumbWidth:(int)thumbWidth
+                     resumeState:(nullable FFThumbnailResumeState *)resumeState;
+
+/// Generates additional thumbnails between the given times, which are normally the times of two neighbouring thumbnails.
+///
+/// The thumbnails at the given times are not generated again. The result is passed to `didRefineThumbnails:forFile:`. A job started
+/// by `generateThumbnailForFile:thumbWidth:` cancels the refinements that have not started yet.
+- (void)refineThumbnailsForFile:(nonnull NSString *)file
+                     thumbWidth:(int)thumbWidth
+                       fromTime:(double)startTime
+                         toTime:(double)endTime;
+
+/// Returns the duration of the file under the key `@iina_duration`, `-1` if unknown, a summary of its streams such as
+/// "1 video, 2 audio" under `@iina_streams`, the codec of its main stream under `@iina_codec` and its metadata tags.
+///
+/// The duration is taken from the container header when present. Otherwise it is estimated by probing the first packets with reduced
+/// limits, and only if that fails by a full probe of the streams.
 + (nullable NSDictionary *)probeVideoInfoForFile:(nonnull NSString *)file;
 
+/// Returns the number of files, the average time and the average number of bytes read of `probeVideoInfoForFile:` by format and
+/// by the tier the duration was found in.
++ (nonnull NSDictionary<NSString *, NSString *> *)probeStatistics;
+
 @end
@@ -20,6 +20,7 @@
 #pragma clang diagnostic pop
 
 #import "IINA-Swift.h"
+#import "ThumbnailScaler.h"
 
 #define LOG_DEBUG(msg, ...) [FFmpegLogger debug:([NSString stringWithFormat:(msg), ##__VA_ARGS__])];
 #define LOG_ERROR(msg, ...) [FFmpegLogger error:([NSString stringWithFormat:(msg), ##__VA_ARGS__])];
@@ -27,6 +28,35 @@
 
 #define THUMB_COUNT_DEFAULT 100
 
+// Adaptive density: at most one preview point per THUMB_POINTS_PER_PREVIEW points of seek bar and one per
+// THUMB_MIN_INTERVAL seconds, fewer for videos with keyframes further apart than THUMB_SCENE_INTERVAL seconds.
+#define THUMB_POINTS_PER_PREVIEW 2
+#define THUMB_MIN_INTERVAL 1.0
+#define THUMB_SCENE_INTERVAL 10.0
+#define THUMB_COUNT_STEP 25
+#define THUMB_REFINEMENT_COUNT_DEFAULT 4
+
+// Scene aware sampling: up to THUMB_SCENE_MAX_FRAMES frames within THUMB_SCENE_WINDOW seconds after a preview point
+// are decoded, every THUMB_SCENE_FRAME_STEP-th is scored. Thumbnails whose luma deviates less than
+// THUMB_BLANK_DEVIATION are blank, those whose signature differs less than THUMB_DUPLICATE_DIFFERENCE from a
+// neighbour are duplicates.
+#define THUMB_SCENE_MAX_FRAMES 24
+#define THUMB_SCENE_FRAME_STEP 4
+#define THUMB_SCENE_WINDOW 3.0
+#define THUMB_BLANK_DEVIATION 8.0
+#define THUMB_DUPLICATE_DIFFERENCE 4.0
+#define THUMB_SIGNATURE_GRID 8
+
+// Limits of avformat_find_stream_info when it is only used to estimate the duration, the defaults
+// are 5 MB and 5 seconds
+#define PROBE_DURATION_PROBESIZE (1 << 20)
+#define PROBE_DURATION_ANALYZE_DURATION AV_TIME_BASE
+
+// Network mode: size of the buffer of the AVIOContext, which is the size of the reads issued to
+// the network, and default number of connections
+#define THUMB_NETWORK_BUFFER_SIZE (256 * 1024)
+#define THUMB_NETWORK_CONNECTION_COUNT_DEFAULT 2
+
 #define CHECK_NOTNULL(ptr,msg) if (ptr == NULL) {\
 LOG_ERROR(@"Error when getting thumbnails: %@", msg);\
 return -1;\
@@ -42,7 +72,295 @@ LOG_ERROR(@"Error when getting thumbnails: %@", msg);\
 return -1;\
 }
 
-@implementation FFThumbnail
+@implementation FFThumbnailBuffer {
+  NSMutableData *_data;
+}
+
+- (instancetype)initWithWidth:(int)width height:(int)height capacity:(NSInteger)capacity
+{
+  self = [super init];
+  if (self) {
+    _width = width;
+    _height = height;
+    // Keep every row aligned so the scaler can use its fast path when writing into the buffer.
+    _bytesPerRow = FFALIGN(width * 4, 16);
+    _capacity = capacity;
+    _data = [[NSMutableData alloc] initWithLength:_bytesPerRow * height * capacity];
+  }
+  return self;
+}
+
+- (uint8_t *)pixelsAtIndex:(NSInteger)index
+{
+  return (uint8_t *)_data.mutableBytes + _bytesPerRow * _height * index;
+}
+
+@end
+
+
+static void releaseThumbnailBuffer(void *info, const void *data, size_t size)
+{
+  CFBridgingRelease(info);
+}
+
+@implementation FFThumbnail {
+  NSImage *_image;
+}
+
+- (instancetype)initWithBuffer:(FFThumbnailBuffer *)buffer index:(NSInteger)index realTime:(double)realTime
+{
+  self = [super init];
+  if (self) {
+    _buffer = buffer;
+    _bufferIndex = index;
+    _realTime = realTime;
+  }
+  return self;
+}
+
+- (CGImageRef)createCGImage
+{
+  if (!_buffer) {
+    CGImageRef cgImage = [self.image CGImageForProposedRect:NULL context:nil hints:nil];
+    return cgImage ? CGImageRetain(cgImage) : NULL;
+  }
+  // The data provider keeps the buffer alive for as long as the image exists.
+  const size_t size = _buffer.bytesPerRow * _buffer.height;
+  CGDataProviderRef provider = CGDataProviderCreateWithData((void *)CFBridgingRetain(_buffer),
+                                                            [_buffer pixelsAtIndex:_bufferIndex], size,
+                                                            releaseThumbnailBuffer);
+  CGColorSpaceRef rgb = CGColorSpaceCreateDeviceRGB();
+  CGImageRef cgImage = CGImageCreate(_buffer.width, _buffer.height, 8, 32, _buffer.bytesPerRow, rgb,
+                                     kCGImageAlphaPremultipliedLast, provider, NULL, false,
+                                     kCGRenderingIntentDefault);
+  CGColorSpaceRelease(rgb);
+  CGDataProviderRelease(provider);
+  return cgImage;
+}
+
+- (NSImage *)image
+{
+  @synchronized (self) {
+    if (!_image && _buffer) {
+      CGImageRef cgImage = [self createCGImage];
+      if (cgImage) {
+        _image = [[NSImage alloc] initWithCGImage:cgImage size:NSZeroSize];
+        CGImageRelease(cgImage);
+      }
+    }
+    return _image;
+  }
+}
+
+- (void)setImage:(NSImage *)image
+{
+  @synchronized (self) {
+    _image = image;
+  }
+}
+
+@end
+
+
+@implementation FFThumbnailResumeState
+
+@end
+
+
+/// Scaler contexts, frames and frame buffers shared by thumbnail jobs and image decoding.
+///
+/// Creating a scaler context calculates its filter coefficients, which costs more than converting a thumbnail. Idle contexts are
+/// kept keyed by their source and destination format and size, and each context is handed to one user at a time. Buffers for
+/// frames that are not filled by a decoder come from an `AVBufferPool` per buffer size. All methods are thread safe.
+@interface FFResourcePool: NSObject
+
++ (FFResourcePool *)sharedPool;
+
+/// Returns a scaler for the given conversion, to be passed to `recycleScaler:` when no longer needed.
+- (struct SwsContext *)scalerFromWidth:(int)srcWidth height:(int)srcHeight format:(enum AVPixelFormat)srcFormat
+                               toWidth:(int)dstWidth height:(int)dstHeight format:(enum AVPixelFormat)dstFormat
+                                 flags:(int)flags;
+- (void)recycleScaler:(struct SwsContext *)scaler;
+
+/// Returns an empty frame, to be passed to `recycleFrame:` when no longer needed.
+- (AVFrame *)frame;
+
+/// Returns a frame with a buffer for the given format and size whose rows are not padded, to be passed to `recycleFrame:` when
+/// no longer needed.
+- (AVFrame *)frameWithFormat:(enum AVPixelFormat)format width:(int)width height:(int)height;
+
+/// Releases the data of the frame and keeps the frame for reuse. Accepts `NULL`.
+- (void)recycleFrame:(AVFrame *)frame;
+
+/// Counts of the resources created and reused since the app was started.
+- (NSString *)statistics;
+
+@end
+
+// Number of idle resources kept by FFResourcePool, beyond that the least recently used are freed.
+#define POOL_MAX_IDLE_SCALERS 8
+#define POOL_MAX_IDLE_FRAMES 16
+#define POOL_MAX_BUFFER_POOLS 4
+
+@implementation FFResourcePool {
+  NSLock *_lock;
+  // Idle scalers, least recently used first, and the keys of all scalers handed out by the pool
+  NSMutableArray<NSValue *> *_idleScalers;
+  NSMutableDictionary<NSValue *, NSString *> *_scalerKeys;
+  NSMutableArray<NSValue *> *_idleFrames;
+  // Buffer pools keyed by buffer size, least recently used first
+  NSMutableArray<NSNumber *> *_bufferPoolSizes;
+  NSMutableDictionary<NSNumber *, NSValue *> *_bufferPools;
+  int64_t _scalersCreated;
+  int64_t _scalersReused;
+  int64_t _framesCreated;
+  int64_t _framesReused;
+}
+
++ (FFResourcePool *)sharedPool
+{
+  static FFResourcePool *pool;
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    pool = [[FFResourcePool alloc] init];
+  });
+  return pool;
+}
+
+- (instancetype)init
+{
+  self = [super init];
+  if (self) {
+    _lock = [[NSLock alloc] init];
+    _idleScalers = [[NSMutableArray alloc] init];
+    _scalerKeys = [[NSMutableDictionary alloc] init];
+    _idleFrames = [[NSMutableArray alloc] init];
+    _bufferPoolSizes = [[NSMutableArray alloc] init];
+    _bufferPools = [[NSMutableDictionary alloc] init];
+  }
+  return self;
+}
+
+- (struct SwsContext *)scalerFromWidth:(int)srcWidth height:(int)srcHeight format:(enum AVPixelFormat)srcFormat
+                               toWidth:(int)dstWidth height:(int)dstHeight format:(enum AVPixelFormat)dstFormat
+                                 flags:(int)flags
+{
+  NSString *key = [NSString stringWithFormat:@"%d:%dx%d>%d:%dx%d/%d", srcFormat, srcWidth, srcHeight, dstFormat,
+                   dstWidth, dstHeight, flags];
+  [_lock lock];
+  for (NSInteger i = (NSInteger)_idleScalers.count - 1; i >= 0; i--) {
+    NSValue *scaler = _idleScalers[i];
+    if ([_scalerKeys[scaler] isEqualToString:key]) {
+      [_idleScalers removeObjectAtIndex:i];
+      _scalersReused++;
+      [_lock unlock];
+      return scaler.pointerValue;
+    }
+  }
+  _scalersCreated++;
+  [_lock unlock];
+  struct SwsContext *scaler = sws_getContext(srcWidth, srcHeight, srcFormat, dstWidth, dstHeight, dstFormat, flags,
+                                             NULL, NULL, NULL);
+  if (scaler) {
+    [_lock lock];
+    _scalerKeys[[NSValue valueWithPointer:scaler]] = key;
+    [_lock unlock];
+  }
+  return scaler;
+}
+
+- (void)recycleScaler:(struct SwsContext *)scaler
+{
+  if (!scaler) return;
+  struct SwsContext *evicted = NULL;
+  [_lock lock];
+  [_idleScalers addObject:[NSValue valueWithPointer:scaler]];
+  if (_idleScalers.count > POOL_MAX_IDLE_SCALERS) {
+    evicted = _idleScalers[0].pointerValue;
+    [_scalerKeys removeObjectForKey:_idleScalers[0]];
+    [_idleScalers removeObjectAtIndex:0];
+  }
+  [_lock unlock];
+  sws_freeContext(evicted);
+}
+
+- (AVFrame *)frame
+{
+  [_lock lock];
+  NSValue *idle = _idleFrames.lastObject;
+  if (idle) {
+    [_idleFrames removeLastObject];
+    _framesReused++;
+  } else {
+    _framesCreated++;
+  }
+  [_lock unlock];
+  return idle ? idle.pointerValue : av_frame_alloc();
+}
+
+- (AVFrame *)frameWithFormat:(enum AVPixelFormat)format width:(int)width height:(int)height
+{
+  const int size = av_image_get_buffer_size(format, width, height, 1);
+  if (size < 0) return NULL;
+  NSNumber *key = @(size);
+  AVBufferPool *evicted = NULL;
+  [_lock lock];
+  AVBufferPool *bufferPool = _bufferPools[key].pointerValue;
+  if (bufferPool) {
+    [_bufferPoolSizes removeObject:key];
+  } else {
+    bufferPool = av_buffer_pool_init(size, NULL);
+    _bufferPools[key] = [NSValue valueWithPointer:bufferPool];
+  }
+  [_bufferPoolSizes addObject:key];
+  if (_bufferPoolSizes.count > POOL_MAX_BUFFER_POOLS) {
+    evicted = _bufferPools[_bufferPoolSizes[0]].pointerValue;
+    [_bufferPools removeObjectForKey:_bufferPoolSizes[0]];
+    [_bufferPoolSizes removeObjectAtIndex:0];
+  }
+  // Another caller may evict and free the pool as soon as the lock is released, the buffer keeps it alive from here on
+  AVBufferRef *buffer = bufferPool ? av_buffer_pool_get(bufferPool) : NULL;
+  [_lock unlock];
+  // Buffers still in use keep the pool alive until they are released
+  av_buffer_pool_uninit(&evicted);
+
+  if (!buffer) return NULL;
+  AVFrame *frame = [self frame];
+  if (!frame) {
+    av_buffer_unref(&buffer);
+    return NULL;
+  }
+  frame->buf[0] = buffer;
+  frame->format = format;
+  frame->width = width;
+  frame->height = height;
+  av_image_fill_arrays(frame->data, frame->linesize, buffer->data, format, width, height, 1);
+  return frame;
+}
+
+- (void)recycleFrame:(AVFrame *)frame
+{
+  if (!frame) return;
+  av_frame_unref(frame);
+  [_lock lock];
+  if (_idleFrames.count < POOL_MAX_IDLE_FRAMES) {
+    [_idleFrames addObject:[NSValue valueWithPointer:frame]];
+    frame = NULL;
+  }
+  [_lock unlock];
+  av_frame_free(&frame);
+}
+
+- (NSString *)statistics
+{
+  [_lock lock];
+  NSString *statistics = [NSString stringWithFormat:@"%lld scalers created, %lld reused, %lu idle; %lld frames created, "
+                          "%lld reused, %lu idle; %lu buffer pools", _scalersCreated, _scalersReused,
+                          (unsigned long)_idleScalers.count, _framesCreated, _framesReused,
+                          (unsigned long)_idleFrames.count, (unsigned long)_bufferPools.count];
+  [_lock unlock];
+  return statistics;
+}
 
 @end
 
@@ -53,10 +371,70 @@ return -1;\
   NSMutableSet *_addedTimestamps;
   NSOperationQueue *_queue;
   double _timestamp;
+
+  // Results of the segment workers, indexed by preview point. Segments finish out of order, so in
+  // linear order a result is only delivered once every preview point before it has been delivered.
+  // In progressive order results are delivered in the order they finish.
+  NSLock *_resultLock;
+  // Held while the delegate is notified of results. It is taken before `_resultLock` is released,
+  // so notifications keep the order of their results without blocking the workers.
+  NSLock *_notificationLock;
+  NSMutableArray *_pendingThumbnails;
+  NSMutableArray *_pendingTimestamps;
+  NSMutableIndexSet *_finishedIndexes;
+  NSMutableArray<NSNumber *> *_finishOrder;
+  NSMutableIndexSet *_coveredIndexes;
+  int _deliveryPosition;
+  double _jobStartTime;
+
+  // Preview points restored from a resume state, points abandoned because their segment failed,
+  // and the points processed since the delegate was last told about them.
+  FFThumbnailResumeState *_resumeState;
+  NSMutableIndexSet *_resumedIndexes;
+  NSMutableIndexSet *_abandonedIndexes;
+  NSMutableIndexSet *_processedIndexes;
+  NSMutableDictionary<NSNumber *, FFThumbnail *> *_processedThumbnails;
+  int64_t _decodedPacketCount;
+  FFThumbnailBuffer *_thumbnailBuffer;
+  double _decodeTime;
+  int _activeWorkerCount;
+
+  // The part of the timeline the current job covers and the number of intervals it is divided
+  // into. A refinement covers the range between two thumbnails instead of the whole timeline.
+  BOOL _refining;
+  int _jobThumbnailCount;
+  // The file opened to choose the number of intervals, taken over by the worker of the first segment.
+  AVFormatContext *_jobFormatContext;
+  double _jobRangeStart;
+  double _jobRangeEnd;
+
+  // Luma signatures of the saved thumbnails by preview point, used to recognize blank and duplicate
+  // thumbnails, and the number of frames decoded in search of better ones.
+  NSMutableDictionary<NSNumber *, NSData *> *_signatures;
+  NSMutableIndexSet *_signedIndexes;
+  int64_t _extraFrameCount;
+
+  // Bytes read from the file in network mode and preview points that shared a keyframe with another
+  int64_t _networkBytesRead;
+  int _coalescedPointCount;
 }
 
 - (int)getPeeksForFile:(NSString *)file thumbnailsWidth:(int)thumbnailsWidth;
-- (void)saveThumbnail:(AVFrame *)pFrame width:(int)width height:(int)height index:(int)index realTime:(int)second forFile:(NSString *)file;
+- (int)getPeeksForFile:(NSString *)file thumbnailsWidth:(int)thumbnailsWidth fromIndex:(int)first toIndex:(int)last;
+- (NSInteger)adaptiveThumbnailCountForFile:(NSString *)file;
+- (FFThumbnailBuffer *)thumbnailBufferWithWidth:(int)width height:(int)height;
+- (void)saveThumbnailAtIndex:(int)index realTime:(int)second timestamp:(int64_t)timestamp forFile:(NSString *)file;
+- (void)skipThumbnailAtIndex:(int)index forFile:(NSString *)file;
+- (void)finishIndex:(int)index;
+- (double)differenceToNeighboursOfIndex:(int)index signature:(NSData *)signature;
+#if DEBUG
+- (void)logStatisticsOfJobWithPointCount:(int)pointCount duration:(double)duration;
+- (double)distinctThumbnailsPerHundred;
+- (double)largestCoverageGap;
+#endif
+- (void)deliverFinishedThumbnailsForFile:(NSString *)file;
+- (void)reportProcessedPointsForFile:(NSString *)file into:(NSMutableArray<dispatch_block_t> *)notifications;
+- (void)unlockResultsAndNotify:(NSArray<dispatch_block_t> *)notifications;
 
 @end
 
@@ -68,11 +446,37 @@ return -1;\
   self = [super init];
   if (self) {
     self.thumbnailCount = THUMB_COUNT_DEFAULT;
+    self.thumbnailAdaptiveDensity = NO;
+    self.thumbnailSeekBarWidth = 0;
+    self.thumbnailRefinementCount = THUMB_REFINEMENT_COUNT_DEFAULT;
+    self.thumbnailWorkerCount = 1;
+    self.thumbnailKeyframesOnly = NO;
+    self.thumbnailFastDecoding = YES;
+    self.thumbnailDecoderThreadCount = 0;
+    self.thumbnailFrameThreading = NO;
+    self.thumbnailProgressiveOrder = NO;
+    self.thumbnailSceneAware = NO;
+    self.thumbnailNetworkMode = NO;
+    self.thumbnailNetworkConnectionCount = THUMB_NETWORK_CONNECTION_COUNT_DEFAULT;
+    self.thumbnailNetworkByteRate = 0;
     _thumbnails = [[NSMutableArray alloc] init];
     _thumbnailPartialResult = [[NSMutableArray alloc] init];
     _addedTimestamps = [[NSMutableSet alloc] init];
     _queue = [[NSOperationQueue alloc] init];
     _queue.maxConcurrentOperationCount = 1;
+    _resultLock = [[NSLock alloc] init];
+    _notificationLock = [[NSLock alloc] init];
+    _pendingThumbnails = [[NSMutableArray alloc] init];
+    _pendingTimestamps = [[NSMutableArray alloc] init];
+    _finishedIndexes = [[NSMutableIndexSet alloc] init];
+    _finishOrder = [[NSMutableArray alloc] init];
+    _coveredIndexes = [[NSMutableIndexSet alloc] init];
+    _resumedIndexes = [[NSMutableIndexSet alloc] init];
+    _abandonedIndexes = [[NSMutableIndexSet alloc] init];
+    _processedIndexes = [[NSMutableIndexSet alloc] init];
+    _processedThumbnails = [[NSMutableDictionary alloc] init];
+    _signatures = [[NSMutableDictionary alloc] init];
+    _signedIndexes = [[NSMutableIndexSet alloc] init];
   }
   return self;
 }
@@ -81,6 +485,13 @@ return -1;\
 
 - (void)generateThumbnailForFile:(NSString *)file
                       thumbWidth:(int)thumbWidth
+{
+  [self generateThumbnailForFile:file thumbWidth:thumbWidth resumeState:nil];
+}
+
+- (void)generateThumbnailForFile:(NSString *)file
+                      thumbWidth:(int)thumbWidth
+                     resumeState:(FFThumbnailResumeState *)resumeState
 {
   [_queue cancelAllOperations];
   NSBlockOperation *op = [[NSBlockOperation alloc] init];
@@ -90,6 +501,10 @@ return -1;\
       return;
     }
     self->_timestamp = CACurrentMediaTime();
+    self->_resumeState = resumeState;
+    self->_refining = NO;
+    self->_jobRangeStart = NAN;
+    self->_jobRangeEnd = NAN;
     int success = [self getPeeksForFile:file thumbnailsWidth:thumbWidth];
     if (self.delegate) {
       [self.delegate didGenerateThumbnails:[NSArray arrayWithArray:self->_thumbnails]
@@ -100,275 +515,1159 @@ return -1;\
   [_queue addOperation:op];
 }
 
+- (void)refineThumbnailsForFile:(NSString *)file
+                     thumbWidth:(int)thumbWidth
+                       fromTime:(double)startTime
+                         toTime:(double)endTime
+{
+  NSBlockOperation *op = [[NSBlockOperation alloc] init];
+  __weak NSBlockOperation *weakOp = op;
+  [op addExecutionBlock:^(){
+    if ([weakOp isCancelled]) {
+      return;
+    }
+    self->_timestamp = CACurrentMediaTime();
+    self->_resumeState = nil;
+    self->_refining = YES;
+    self->_jobThumbnailCount = (int)MAX(self.thumbnailRefinementCount, 2);
+    self->_jobRangeStart = startTime;
+    self->_jobRangeEnd = endTime;
+    int success = [self getPeeksForFile:file thumbnailsWidth:thumbWidth];
+    if (success >= 0 && [self.delegate respondsToSelector:@selector(didRefineThumbnails:forFile:)]) {
+      [self.delegate didRefineThumbnails:[NSArray arrayWithArray:self->_thumbnails] forFile:file];
+    }
+  }];
+  [_queue addOperation:op];
+}
+
+- (NSInteger)effectiveWorkerCount
+{
+  NSInteger workers = self.thumbnailWorkerCount;
+  if (workers <= 0) {
+    // Automatic: every worker holds its own demuxer and decoder, so leave half of the cores to
+    // playback and cap the memory used by decoders of high resolution video.
+    workers = MIN(MAX([NSProcessInfo processInfo].activeProcessorCount / 2, 1), 4);
+  }
+  if (self.thumbnailNetworkMode) {
+    // Every worker has its own connection
+    workers = MIN(workers, MAX(self.thumbnailNetworkConnectionCount, 1));
+  }
+  // There are thumbnailCount + 1 preview points, never use more workers than that.
+  return MIN(workers, _jobThumbnailCount + 1);
+}
+
 - (int)getPeeksForFile:(NSString *)file
        thumbnailsWidth:(int)thumbnailsWidth
 {
-  int i, ret;
-
-  char *cFilename = strdup(file.fileSystemRepresentation);
   [_thumbnails removeAllObjects];
   [_thumbnailPartialResult removeAllObjects];
   [_addedTimestamps removeAllObjects];
 
-  // Register all formats and codecs. mpv should have already called it.
-  // av_register_all();
+  if (!_refining) {
+    // Choosing the density reads the index of the file, which is not worth it over the network. The count is kept for the job
+    // only, the delegate reads it from the notifications of this job.
+    const BOOL adaptive = self.thumbnailAdaptiveDensity && self.thumbnailSeekBarWidth > 0 && !self.thumbnailNetworkMode;
+    _jobThumbnailCount = (int)(adaptive ? [self adaptiveThumbnailCountForFile:file] : self.thumbnailCount);
+  }
+  const int pointCount = _jobThumbnailCount + 1;
+  [_pendingThumbnails removeAllObjects];
+  [_pendingTimestamps removeAllObjects];
+  for (int i = 0; i < pointCount; i++) {
+    [_pendingThumbnails addObject:[NSNull null]];
+    [_pendingTimestamps addObject:@(AV_NOPTS_VALUE)];
+  }
+  [_finishedIndexes removeAllIndexes];
+  [_finishOrder removeAllObjects];
+  [_coveredIndexes removeAllIndexes];
+  [_resumedIndexes removeAllIndexes];
+  [_abandonedIndexes removeAllIndexes];
+  [_processedIndexes removeAllIndexes];
+  [_processedThumbnails removeAllObjects];
+  [_signatures removeAllObjects];
+  [_signedIndexes removeAllIndexes];
+  _extraFrameCount = 0;
+  _networkBytesRead = 0;
+  _coalescedPointCount = 0;
+  _deliveryPosition = 0;
+
+  if (_refining) {
+    // The ends of the range already have a thumbnail, treat them as restored so they are skipped
+    for (int i = 0; i < pointCount; i += pointCount - 1) {
+      _pendingTimestamps[i] = [NSNull null];
+      [_resumedIndexes addIndex:i];
+      [self finishIndex:i];
+    }
+  }
 
-  // Open video file
-  AVFormatContext *pFormatCtx = NULL;
-  ret = avformat_open_input(&pFormatCtx, cFilename, NULL, NULL);
-  free(cFilename);
-  CHECK_SUCCESS(ret, @"Cannot open video")
+  // Restore the preview points processed by an interrupted job
+  if (_resumeState && _resumeState.thumbnailCount == _jobThumbnailCount) {
+    [_resumeState.processedPoints enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+      if ((NSInteger)index >= pointCount) return;
+      FFThumbnail *tb = self->_resumeState.thumbnails[@(index)];
+      self->_pendingThumbnails[index] = tb ? tb : [NSNull null];
+      // Restored thumbnails were checked for duplicates when they were generated
+      self->_pendingTimestamps[index] = [NSNull null];
+      [self->_resumedIndexes addIndex:index];
+      [self finishIndex:(int)index];
+    }];
+    LOG_DEBUG(@"Resuming thumbnail generation with %lu of %d preview points processed",
+              (unsigned long)_resumedIndexes.count, pointCount);
+  }
+  _resumeState = nil;
+  [self deliverFinishedThumbnailsForFile:file];
+  _decodedPacketCount = 0;
+  _thumbnailBuffer = nil;
+  _decodeTime = 0;
+
+  // Split the timeline into contiguous segments, each one processed by a worker with its own
+  // demuxer and decoder. A refinement has too few preview points to be worth opening the file
+  // more than once.
+  const int workers = _refining ? 1 : (int)[self effectiveWorkerCount];
+  _activeWorkerCount = workers;
+  const double startTime = CACurrentMediaTime();
+  _jobStartTime = startTime;
+  __block int result = 0;
+  dispatch_apply(workers, dispatch_get_global_queue(QOS_CLASS_UTILITY, 0), ^(size_t segment) {
+    const int first = (int)(pointCount * segment / workers);
+    const int last = (int)(pointCount * (segment + 1) / workers) - 1;
+    int ret = [self getPeeksForFile:file thumbnailsWidth:thumbnailsWidth fromIndex:first toIndex:last];
+    // Whatever this segment did not produce will never arrive, allow later results through.
+    [self->_resultLock lock];
+    for (int i = first; i <= last; i++) {
+      if (![self->_finishedIndexes containsIndex:i]) {
+        [self->_abandonedIndexes addIndex:i];
+        [self finishIndex:i];
+      }
+    }
+    if (ret < 0) {
+      result = ret;
+    }
+    [self->_resultLock unlock];
+    [self deliverFinishedThumbnailsForFile:file];
+  });
+  // In case no worker took the file over
+  avformat_close_input(&_jobFormatContext);
+
+  if (!_refining) {
+    NSMutableArray<dispatch_block_t> *notifications = [[NSMutableArray alloc] init];
+    [_resultLock lock];
+    [self reportProcessedPointsForFile:file into:notifications];
+    [self unlockResultsAndNotify:notifications];
+  }
 
-  // Find stream information
-  ret = avformat_find_stream_info(pFormatCtx, NULL);
-  CHECK_SUCCESS(ret, @"Cannot get stream info")
+  if (self.thumbnailProgressiveOrder) {
+    // Hand the complete set over in timeline order.
+    [_thumbnails sortUsingComparator:^NSComparisonResult(FFThumbnail *tb1, FFThumbnail *tb2) {
+      return tb1.realTime < tb2.realTime ? NSOrderedAscending :
+          (tb1.realTime > tb2.realTime ? NSOrderedDescending : NSOrderedSame);
+    }];
+  }
 
-  // Find the first video stream
-  int videoStream = -1;
-  for (i = 0; i < pFormatCtx->nb_streams; i++)
-    if (pFormatCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
-      videoStream = i;
-      break;
+  const double duration = CACurrentMediaTime() - startTime;
+  LOG_DEBUG(@"Generated %lu thumbnails in %.3fs using %d worker(s)", (unsigned long)_thumbnails.count, duration, workers);
+#if DEBUG
+  [self logStatisticsOfJobWithPointCount:pointCount duration:duration];
+#endif
+  return result;
+}
+
+/// Returns the order in which the preview points of a segment are processed.
+///
+/// In progressive order the segment is first sampled coarsely and then refined by halving the distance between the points, for
+/// example every 16th point, then the points in between at every 8th, and so on. Partial results then cover the whole segment
+/// early instead of only its beginning.
+static NSArray<NSNumber *> *thumbnailOrder(int first, int last, BOOL progressive)
+{
+  NSMutableArray<NSNumber *> *order = [[NSMutableArray alloc] initWithCapacity:last - first + 1];
+  if (!progressive) {
+    for (int i = first; i <= last; i++) {
+      [order addObject:@(i)];
+    }
+    return order;
+  }
+  int step = 1;
+  while (step * 2 <= last - first) {
+    step *= 2;
+  }
+  NSMutableIndexSet *added = [[NSMutableIndexSet alloc] init];
+  for (; step >= 1; step /= 2) {
+    for (int i = first; i <= last; i += step) {
+      if (![added containsIndex:i]) {
+        [added addIndex:i];
+        [order addObject:@(i)];
+      }
     }
-  CHECK_SUCCESS(videoStream, @"No video stream")
+  }
+  return order;
+}
 
-  // Get the codec context for the video stream
-  AVStream *pVideoStream = pFormatCtx->streams[videoStream];
+/// Reduce the decoding work for frames that are only used to create thumbnails.
+///
+/// The decoder settings are chosen by how much larger the source is than the thumbnail. The artifacts caused by skipping the
+/// loop filter and the IDCT of B-frames disappear when the frame is scaled down this much, and frames are decoded at a
+/// reduced resolution by decoders supporting `lowres` as long as the result is still at least twice the thumbnail width.
+/// - Important: This must be called before the codec is opened.
+static void configureThumbnailDecoder(AVCodecContext *pCodecCtx, const AVCodec *pCodec, int thumbWidth)
+{
+  if (thumbWidth <= 0 || pCodecCtx->width <= 0) return;
+  const double ratio = (double)pCodecCtx->width / thumbWidth;
+  if (ratio >= 2) {
+    pCodecCtx->flags2 |= AV_CODEC_FLAG2_FAST;
+    pCodecCtx->skip_loop_filter = AVDISCARD_NONREF;
+  }
+  if (ratio >= 4) {
+    pCodecCtx->skip_loop_filter = AVDISCARD_ALL;
+    pCodecCtx->skip_idct = AVDISCARD_BIDIR;
+  }
+  int lowres = 0;
+  while (lowres < pCodec->max_lowres && (pCodecCtx->width >> (lowres + 1)) >= thumbWidth * 2) {
+    lowres++;
+  }
+  pCodecCtx->lowres = lowres;
+  LOG_DEBUG(@"Thumbnail decoder %s: scale ratio %.1f, lowres %d, skip_loop_filter %d, skip_idct %d", pCodec->name,
+            ratio, lowres, pCodecCtx->skip_loop_filter, pCodecCtx->skip_idct);
+}
 
-  AVRational videoAvgFrameRate = pVideoStream->avg_frame_rate;
+/// Permit the thumbnail decoder to use multiple threads.
+///
+/// Only one frame is needed after each seek, so by default only slice threading is allowed. Frame threading adds a frame of
+/// latency per thread before the first frame is output, which is pure overhead for this access pattern. Decoders that do their own
+/// threading, such as libdav1d, are covered by `AV_CODEC_CAP_OTHER_THREADS`. As with `createNSImageWithContentsOfURL:` the
+/// thread count is left alone for decoders without any threading capability.
+/// - Parameters:
+///   - threadCount: Number of threads, `0` to let the decoder choose.
+///   - frameThreading: Whether frame threading may also be used.
+/// - Important: This must be called before the codec is opened.
+static void configureThumbnailDecoderThreads(AVCodecContext *pCodecCtx, const AVCodec *pCodec, int threadCount,
+                                             BOOL frameThreading)
+{
+  const int capabilities = pCodec->capabilities;
+  int threadType = 0;
+  if (capabilities & AV_CODEC_CAP_SLICE_THREADS) threadType |= FF_THREAD_SLICE;
+  if (frameThreading && (capabilities & AV_CODEC_CAP_FRAME_THREADS)) threadType |= FF_THREAD_FRAME;
+  if (threadType == 0 && !(capabilities & AV_CODEC_CAP_OTHER_THREADS)) return;
+  pCodecCtx->thread_count = threadCount;
+  if (threadType != 0) {
+    pCodecCtx->thread_type = threadType;
+  }
+}
 
-  // Check whether the denominator (AVRational.den) is zero to prevent division-by-zero
-  if (videoAvgFrameRate.den == 0 || av_q2d(videoAvgFrameRate) == 0) {
-    LOG_DEBUG(@"Avg frame rate = 0, ignore");
-    return -1;
+/// The input of a worker in network mode. Reads go through an AVIOContext with a buffer of
+/// THUMB_NETWORK_BUFFER_SIZE, so the keyframe at a preview point is fetched with few large reads, and are
+/// counted and throttled to the byte rate of the worker.
+typedef struct ThrottledInput {
+  AVIOContext *source;
+  AVIOContext *context;
+  int64_t byteRate;
+  int64_t bytesRead;
+  double startTime;
+} ThrottledInput;
+
+static int throttledRead(void *opaque, uint8_t *buf, int size)
+{
+  ThrottledInput *input = opaque;
+  int ret = avio_read_partial(input->source, buf, size);
+  if (ret == 0)
+    return AVERROR_EOF;
+  if (ret < 0)
+    return ret;
+  input->bytesRead += ret;
+  if (input->byteRate > 0) {
+    // Wait until the bytes read so far fit into the byte rate
+    const double wait = input->startTime + (double)input->bytesRead / input->byteRate - CACurrentMediaTime();
+    if (wait > 0)
+      usleep((useconds_t)(wait * 1e6));
   }
+  return ret;
+}
 
-  // Find the decoder for the video stream
-  const AVCodec *pCodec = avcodec_find_decoder(pVideoStream->codecpar->codec_id);
-  CHECK_NOTNULL(pCodec, @"Unsupported codec")
+static int64_t throttledSeek(void *opaque, int64_t offset, int whence)
+{
+  ThrottledInput *input = opaque;
+  if (whence & AVSEEK_SIZE)
+    return avio_size(input->source);
+  return avio_seek(input->source, offset, whence);
+}
 
-  // Open codec
-  AVCodecContext *pCodecCtx = avcodec_alloc_context3(pCodec);
+/// Open the given file through a `ThrottledInput`, which must be freed with `closeThrottledInput` after the
+/// format context has been closed, also if this fails.
+static int openThrottledInput(AVFormatContext **ppFormatCtx, const char *url, int64_t byteRate,
+                              ThrottledInput **pInput)
+{
+  ThrottledInput *input = av_mallocz(sizeof(ThrottledInput));
+  if (!input)
+    return AVERROR(ENOMEM);
+  *pInput = input;
+  input->byteRate = byteRate;
+  input->startTime = CACurrentMediaTime();
+
+  // Keep the HTTP connection open between range requests
+  AVDictionary *options = NULL;
+  av_dict_set(&options, "multiple_requests", "1", 0);
+  int ret = avio_open2(&input->source, url, AVIO_FLAG_READ, NULL, &options);
+  av_dict_free(&options);
+  if (ret < 0)
+    return ret;
+
+  uint8_t *buffer = av_malloc(THUMB_NETWORK_BUFFER_SIZE);
+  if (!buffer)
+    return AVERROR(ENOMEM);
+  input->context = avio_alloc_context(buffer, THUMB_NETWORK_BUFFER_SIZE, 0, input, throttledRead, NULL, throttledSeek);
+  if (!input->context) {
+    av_free(buffer);
+    return AVERROR(ENOMEM);
+  }
+  input->context->seekable = input->source->seekable;
+
+  *ppFormatCtx = avformat_alloc_context();
+  if (!*ppFormatCtx)
+    return AVERROR(ENOMEM);
+  (*ppFormatCtx)->pb = input->context;
+  (*ppFormatCtx)->flags |= AVFMT_FLAG_CUSTOM_IO;
+  return avformat_open_input(ppFormatCtx, url, NULL, NULL);
+}
+
+static void closeThrottledInput(ThrottledInput **pInput)
+{
+  ThrottledInput *input = *pInput;
+  if (!input)
+    return;
+  if (input->context) {
+    av_freep(&input->context->buffer);
+    avio_context_free(&input->context);
+  }
+  avio_closep(&input->source);
+  av_freep(pInput);
+}
+
+/// Summarize a thumbnail as the average luma of the cells of a grid followed by the standard deviation of its luma.
+///
+/// The signature is cheap to calculate from the downscaled image and enough to recognize thumbnails that are blank, such
+/// as black frames and fades, and thumbnails that look like one of their neighbours.
+static NSData *thumbnailSignature(const uint8_t *pixels, int width, int height, size_t bytesPerRow)
+{
+  const int cells = THUMB_SIGNATURE_GRID * THUMB_SIGNATURE_GRID;
+  uint32_t sums[cells], counts[cells];
+  memset(sums, 0, sizeof(sums));
+  memset(counts, 0, sizeof(counts));
+  double sum = 0, sumOfSquares = 0;
+  for (int y = 0; y < height; y++) {
+    const uint8_t *row = pixels + y * bytesPerRow;
+    const int cellRow = y * THUMB_SIGNATURE_GRID / height * THUMB_SIGNATURE_GRID;
+    for (int x = 0; x < width; x++) {
+      const uint8_t *pixel = row + 4 * x;
+      // BT.709 luma weights in 8 bit fixed point
+      const uint32_t luma = (pixel[0] * 54 + pixel[1] * 183 + pixel[2] * 19) >> 8;
+      const int cell = cellRow + x * THUMB_SIGNATURE_GRID / width;
+      sums[cell] += luma;
+      counts[cell]++;
+      sum += luma;
+      sumOfSquares += luma * luma;
+    }
+  }
+  uint8_t signature[cells + 1];
+  for (int cell = 0; cell < cells; cell++) {
+    signature[cell] = counts[cell] == 0 ? 0 : sums[cell] / counts[cell];
+  }
+  const double pixelCount = MAX(width * height, 1);
+  const double mean = sum / pixelCount;
+  signature[cells] = MIN(sqrt(MAX(sumOfSquares / pixelCount - mean * mean, 0)), 255);
+  return [NSData dataWithBytes:signature length:sizeof(signature)];
+}
+
+static double signatureDeviation(NSData *signature)
+{
+  return ((const uint8_t *)signature.bytes)[signature.length - 1];
+}
+
+/// Returns the mean difference between the cells of two signatures.
+static double signatureDifference(NSData *signature1, NSData *signature2)
+{
+  const uint8_t *cells1 = signature1.bytes, *cells2 = signature2.bytes;
+  const int cells = THUMB_SIGNATURE_GRID * THUMB_SIGNATURE_GRID;
+  int difference = 0;
+  for (int cell = 0; cell < cells; cell++) {
+    difference += abs(cells1[cell] - cells2[cell]);
+  }
+  return (double)difference / cells;
+}
+
+#if DEBUG
+/// Log how much work the last thumbnail job did and how good its thumbnails are.
+- (void)logStatisticsOfJobWithPointCount:(int)pointCount duration:(double)duration
+{
+  LOG_DEBUG(@"Thumbnail buffer uses %lu bytes", (unsigned long)(_thumbnailBuffer.bytesPerRow *
+            _thumbnailBuffer.height * _thumbnailBuffer.capacity));
+  LOG_DEBUG(@"Decoded %.2f packets per thumbnail%@", _thumbnails.count == 0 ? 0 :
+            (double)_decodedPacketCount / _thumbnails.count,
+            self.thumbnailKeyframesOnly || self.thumbnailNetworkMode ? @" (keyframes only)" : @"");
+  if (self.thumbnailNetworkMode) {
+    LOG_DEBUG(@"Read %lld bytes in network mode for %lu thumbnails, %lld bytes per thumbnail, %d preview points shared a keyframe",
+              _networkBytesRead, (unsigned long)_thumbnails.count,
+              _thumbnails.count == 0 ? 0 : _networkBytesRead / (int64_t)_thumbnails.count, _coalescedPointCount);
+  }
+  LOG_DEBUG(@"Spent %.2fms decoding per thumbnail", _thumbnails.count == 0 ? 0 :
+            _decodeTime * 1000 / _thumbnails.count);
+  LOG_DEBUG(@"Generated %.1f thumbnails per second with %ld decoder thread(s) per worker using %@ threading",
+            _thumbnails.count / duration, (long)self.thumbnailDecoderThreadCount,
+            self.thumbnailFrameThreading ? @"frame and slice" : @"slice");
+  LOG_DEBUG(@"Resource pool: %@", [[FFResourcePool sharedPool] statistics]);
+  LOG_DEBUG(@"%.1f distinct thumbnails per 100, %.2f extra frames decoded per preview point%@",
+            [self distinctThumbnailsPerHundred], (double)_extraFrameCount / pointCount,
+            self.thumbnailSceneAware && !self.thumbnailKeyframesOnly ? @" (scene aware)" : @"");
+}
+
+/// Check the thumbnail kernel against its reference implementation and compare its speed to `sws_scale`.
+static void verifyThumbnailScaler(const AVFrame *pFrame, int width, int height)
+{
+  const int stride = width * 4;
+  NSMutableData *result = [[NSMutableData alloc] initWithLength:stride * height];
+  NSMutableData *reference = [[NSMutableData alloc] initWithLength:stride * height];
+  double start = CACurrentMediaTime();
+  thumbnailScale(pFrame, result.mutableBytes, width, height, stride);
+  const double kernelTime = CACurrentMediaTime() - start;
+  start = CACurrentMediaTime();
+  thumbnailScaleReference(pFrame, reference.mutableBytes, width, height, stride);
+  const double referenceTime = CACurrentMediaTime() - start;
+  if (![result isEqualToData:reference]) {
+    LOG_ERROR(@"Thumbnail kernel result differs from the reference implementation");
+  }
+
+  FFResourcePool *pool = [FFResourcePool sharedPool];
+  struct SwsContext *sws_ctx = [pool scalerFromWidth:pFrame->width height:pFrame->height format:pFrame->format
+                                             toWidth:width height:height format:AV_PIX_FMT_RGBA flags:SWS_BILINEAR];
+  if (!sws_ctx) return;
+  uint8_t *data[4] = {result.mutableBytes};
+  int linesize[4] = {stride};
+  start = CACurrentMediaTime();
+  sws_scale(sws_ctx, (const uint8_t* const *)pFrame->data, pFrame->linesize, 0, pFrame->height, data, linesize);
+  const double swsTime = CACurrentMediaTime() - start;
+  [pool recycleScaler:sws_ctx];
+  LOG_DEBUG(@"Scaling %s %dx%d to %dx%d took %.3fms with the thumbnail kernel, %.3fms with its reference and %.3fms "
+            "with sws_scale", av_get_pix_fmt_name(pFrame->format), pFrame->width, pFrame->height, width, height,
+            kernelTime * 1000, referenceTime * 1000, swsTime * 1000);
+}
+#endif
+
+- (int)getPeeksForFile:(NSString *)file
+       thumbnailsWidth:(int)thumbnailsWidth
+             fromIndex:(int)first
+               toIndex:(int)last
+{
+  int i, ret;
+  int64_t decodedPackets = 0;
+  int64_t extraFrames = 0;
+  double decodeTime = 0;
+  // Network mode only reads the keyframe nearest to each preview point
+  const BOOL networkMode = self.thumbnailNetworkMode;
+  const BOOL keyframesOnly = self.thumbnailKeyframesOnly || networkMode;
+  int coalescedPoints = 0;
+
+  NSMutableSet *addedTimestamps = [[NSMutableSet alloc] init];
+  FFResourcePool *pool = [FFResourcePool sharedPool];
+
+  // Variables holding objects that will need to be freed or returned to the pool.
+  AVFormatContext *pFormatCtx = NULL;
+  AVCodecContext *pCodecCtx = NULL;
   AVDictionary *optionsDict = NULL;
+  AVFrame *pFrame = NULL;
+  AVFrame *pFrameRGB = NULL;
+  struct SwsContext *sws_ctx = NULL;
+  ThrottledInput *throttledInput = NULL;
 
-  avcodec_parameters_to_context(pCodecCtx, pVideoStream->codecpar);
-  pCodecCtx->time_base = pVideoStream->time_base;
+  @try {
+    // Register all formats and codecs. mpv should have already called it.
+    // av_register_all();
+
+    // Open video file, the first segment takes over the file opened to choose the number of intervals
+    if (first == 0) {
+      [_resultLock lock];
+      pFormatCtx = _jobFormatContext;
+      _jobFormatContext = NULL;
+      [_resultLock unlock];
+    }
+    if (!pFormatCtx) {
+      if (networkMode) {
+        // The byte rate is shared by the workers
+        ret = openThrottledInput(&pFormatCtx, file.fileSystemRepresentation,
+                                 self.thumbnailNetworkByteRate / MAX(_activeWorkerCount, 1), &throttledInput);
+      } else {
+        ret = avformat_open_input(&pFormatCtx, file.fileSystemRepresentation, NULL, NULL);
+      }
+      CHECK_SUCCESS(ret, @"Cannot open video")
 
-  if (pCodecCtx->pix_fmt < 0 || pCodecCtx->pix_fmt >= AV_PIX_FMT_NB) {
-    avcodec_free_context(&pCodecCtx);
-    avformat_close_input(&pFormatCtx);
-    LOG_ERROR(@"Error when getting thumbnails: Pixel format is null");
-    return -1;
-  }
-
-  ret = avcodec_open2(pCodecCtx, pCodec, &optionsDict);
-  CHECK_SUCCESS(ret, @"Cannot open codec")
-
-  // Allocate video frame
-  AVFrame *pFrame = av_frame_alloc();
-  CHECK_NOTNULL(pFrame, @"Cannot alloc video frame")
-
-  // Allocate the output frame
-  // We need to convert the video frame to RGBA to satisfy CGImage's data format
-  int thumbWidth = thumbnailsWidth;
-  int thumbHeight = (float)thumbWidth / ((float)pCodecCtx->width / pCodecCtx->height);
-
-  AVFrame *pFrameRGB = av_frame_alloc();
-  CHECK_NOTNULL(pFrameRGB, @"Cannot alloc RGBA frame")
-
-  pFrameRGB->width = thumbWidth;
-  pFrameRGB->height = thumbHeight;
-  pFrameRGB->format = AV_PIX_FMT_RGBA;
-
-  // Determine required buffer size and allocate buffer
-  int size = av_image_get_buffer_size(pFrameRGB->format, thumbWidth, thumbHeight, 1);
-  uint8_t *pFrameRGBBuffer = (uint8_t *)av_malloc(size);
-
-  // Assign appropriate parts of buffer to image planes in pFrameRGB
-  ret = av_image_fill_arrays(pFrameRGB->data,
-                             pFrameRGB->linesize,
-                             pFrameRGBBuffer,
-                             pFrameRGB->format,
-                             pFrameRGB->width,
-                             pFrameRGB->height, 1);
-  CHECK_SUCCESS(ret, @"Cannot fill data for RGBA frame")
-
-  // Create a sws context for converting color space and resizing
-  CHECK(pCodecCtx->pix_fmt != AV_PIX_FMT_NONE, @"Pixel format is none")
-  struct SwsContext *sws_ctx = sws_getContext(pCodecCtx->width, pCodecCtx->height, pCodecCtx->pix_fmt,
-                                              pFrameRGB->width, pFrameRGB->height, pFrameRGB->format,
-                                              SWS_BILINEAR,
-                                              NULL, NULL, NULL);
-
-  // Get duration and interval
-  int64_t duration = av_rescale_q(pFormatCtx->duration, AV_TIME_BASE_Q, pVideoStream->time_base);
-  double interval = duration / (double)self.thumbnailCount;
-  double timebaseDouble = av_q2d(pVideoStream->time_base);
-  AVPacket packet;
-
-  // For each preview point
-  for (i = 0; i <= self.thumbnailCount; i++) {
-    int64_t seek_pos = interval * i + pVideoStream->start_time;
-
-    avcodec_flush_buffers(pCodecCtx);
-
-    // Seek to time point
-    // avformat_seek_file(pFormatCtx, videoStream, seek_pos-interval, seek_pos, seek_pos+interval, 0);
-    ret = av_seek_frame(pFormatCtx, videoStream, seek_pos, AVSEEK_FLAG_BACKWARD);
-    CHECK_SUCCESS(ret, @"Cannot seek")
-
-    avcodec_flush_buffers(pCodecCtx);
-
-    // Read and decode frame
-    while(av_read_frame(pFormatCtx, &packet) >= 0) {
-      @try {
-        // Make sure it's video stream
-        if (packet.stream_index == videoStream) {
-
-          // Decode video frame
-          if (avcodec_send_packet(pCodecCtx, &packet) < 0)
-            break;
+      // Find stream information, in network mode only as much as needed to decode the video stream
+      if (networkMode) {
+        pFormatCtx->probesize = PROBE_DURATION_PROBESIZE;
+        pFormatCtx->max_analyze_duration = PROBE_DURATION_ANALYZE_DURATION;
+      }
+      ret = avformat_find_stream_info(pFormatCtx, NULL);
+      CHECK_SUCCESS(ret, @"Cannot get stream info")
+    }
+
+    // Find the first video stream
+    int videoStream = -1;
+    for (i = 0; i < pFormatCtx->nb_streams; i++)
+      if (pFormatCtx->streams[i]->codecpar->codec_type == AVMEDIA_TYPE_VIDEO) {
+        videoStream = i;
+        break;
+      }
+    CHECK_SUCCESS(videoStream, @"No video stream")
+
+    // Get the codec context for the video stream
+    AVStream *pVideoStream = pFormatCtx->streams[videoStream];
+
+    AVRational videoAvgFrameRate = pVideoStream->avg_frame_rate;
+
+    // Check whether the denominator (AVRational.den) is zero to prevent division-by-zero
+    if (videoAvgFrameRate.den == 0 || av_q2d(videoAvgFrameRate) == 0) {
+      LOG_DEBUG(@"Avg frame rate = 0, ignore");
+      return -1;
+    }
+
+    // Find the decoder for the video stream
+    const AVCodec *pCodec = avcodec_find_decoder(pVideoStream->codecpar->codec_id);
+    CHECK_NOTNULL(pCodec, @"Unsupported codec")
+
+    // Open codec
+    pCodecCtx = avcodec_alloc_context3(pCodec);
+    CHECK_NOTNULL(pCodecCtx, @"Cannot alloc codec context")
+
+    avcodec_parameters_to_context(pCodecCtx, pVideoStream->codecpar);
+    pCodecCtx->time_base = pVideoStream->time_base;
+    if (keyframesOnly) {
+      // Only the keyframe at each preview point is decoded, let the decoder drop everything else.
+      pCodecCtx->skip_frame = AVDISCARD_NONKEY;
+    }
+    if (self.thumbnailFastDecoding) {
+      configureThumbnailDecoder(pCodecCtx, pCodec, thumbnailsWidth);
+    }
+    int threadCount = (int)self.thumbnailDecoderThreadCount;
+    if (threadCount <= 0) {
+      // Share the cores between the workers instead of every decoder starting a thread per core.
+      threadCount = MAX((int)[NSProcessInfo processInfo].activeProcessorCount / _activeWorkerCount, 1);
+    }
+    if (threadCount > 1) {
+      configureThumbnailDecoderThreads(pCodecCtx, pCodec, threadCount, self.thumbnailFrameThreading);
+    }
+
+    CHECK(pCodecCtx->pix_fmt >= 0 && pCodecCtx->pix_fmt < AV_PIX_FMT_NB, @"Pixel format is null")
+
+    ret = avcodec_open2(pCodecCtx, pCodec, &optionsDict);
+    CHECK_SUCCESS(ret, @"Cannot open codec")
+
+    // Allocate video frame
+    pFrame = [pool frame];
+    CHECK_NOTNULL(pFrame, @"Cannot alloc video frame")
+
+    // Allocate the output frame
+    // We need to convert the video frame to RGBA to satisfy CGImage's data format
+    int thumbWidth = thumbnailsWidth;
+    int thumbHeight = (float)thumbWidth / ((float)pVideoStream->codecpar->width / pVideoStream->codecpar->height);
+
+    pFrameRGB = [pool frame];
+    CHECK_NOTNULL(pFrameRGB, @"Cannot alloc RGBA frame")
+
+    pFrameRGB->width = thumbWidth;
+    pFrameRGB->height = thumbHeight;
+    pFrameRGB->format = AV_PIX_FMT_RGBA;
 
-          ret = avcodec_receive_frame(pCodecCtx, pFrame);
-          if (ret < 0) {  // something happened
-            if (ret == AVERROR(EAGAIN))  // input not ready, retry
+    // The frame is converted straight into the slot of the preview point in the thumbnail buffer
+    // shared by all workers, the planes of pFrameRGB are pointed at the slot before scaling
+    FFThumbnailBuffer *thumbnailBuffer = [self thumbnailBufferWithWidth:thumbWidth height:thumbHeight];
+    pFrameRGB->linesize[0] = (int)thumbnailBuffer.bytesPerRow;
+
+    // The sws context for converting color space and resizing is taken from the pool for the first
+    // decoded frame, as decoding at a reduced resolution changes the size of the frames
+    CHECK(pCodecCtx->pix_fmt != AV_PIX_FMT_NONE, @"Pixel format is none")
+    int swsWidth = 0, swsHeight = 0, swsFormat = AV_PIX_FMT_NONE;
+#if DEBUG
+    BOOL verifiedScaler = NO;
+#endif
+    // Only the first frame after a seek can be decoded in keyframe only mode
+    const BOOL sceneAware = self.thumbnailSceneAware && !keyframesOnly;
+    const size_t slotSize = thumbnailBuffer.bytesPerRow * thumbHeight;
+    NSMutableData *candidatePixels = sceneAware ? [[NSMutableData alloc] initWithLength:slotSize] : nil;
+
+    // Get duration and interval
+    double timebaseDouble = av_q2d(pVideoStream->time_base);
+    int64_t rangeStart = pVideoStream->start_time;
+    int64_t duration = av_rescale_q(pFormatCtx->duration, AV_TIME_BASE_Q, pVideoStream->time_base);
+    if (_refining) {
+      rangeStart = _jobRangeStart / timebaseDouble;
+      duration = (_jobRangeEnd - _jobRangeStart) / timebaseDouble;
+    }
+    double interval = duration / (double)_jobThumbnailCount;
+    AVPacket packet;
+
+    // For each preview point in this segment
+    // Keyframes that have been read, preview points whose nearest keyframe has already been read share
+    // its thumbnail instead of reading it again. In network mode the points are processed from start to
+    // end so reads move forward through the file.
+    NSMutableSet<NSNumber *> *readKeyframes = [[NSMutableSet alloc] init];
+    for (NSNumber *point in thumbnailOrder(first, last, self.thumbnailProgressiveOrder && !networkMode)) {
+      i = point.intValue;
+      if ([_resumedIndexes containsIndex:i])
+        continue;
+      int64_t seek_pos = interval * i + rangeStart;
+      BOOL saved = NO;
+      // In scene aware mode the best frame found so far is kept in the slot of the preview point
+      int decodedFrames = 0;
+      double bestScore = -1;
+      int64_t bestTimestamp = AV_NOPTS_VALUE;
+
+      avcodec_flush_buffers(pCodecCtx);
+
+      if (keyframesOnly) {
+        // Seek straight to the nearest preceding keyframe if the demuxer has indexed it.
+        const AVIndexEntry *entry = avformat_index_get_entry_from_timestamp(pVideoStream, seek_pos,
+                                                                            AVSEEK_FLAG_BACKWARD);
+        if (entry && (entry->flags & AVINDEX_KEYFRAME)) {
+          seek_pos = entry->timestamp;
+          if ([readKeyframes containsObject:@(seek_pos)]) {
+            coalescedPoints++;
+            [self skipThumbnailAtIndex:i forFile:file];
+            continue;
+          }
+          [readKeyframes addObject:@(seek_pos)];
+        }
+      }
+
+      // Seek to time point
+      // avformat_seek_file(pFormatCtx, videoStream, seek_pos-interval, seek_pos, seek_pos+interval, 0);
+      ret = av_seek_frame(pFormatCtx, videoStream, seek_pos, AVSEEK_FLAG_BACKWARD);
+      CHECK_SUCCESS(ret, @"Cannot seek")
+
+      avcodec_flush_buffers(pCodecCtx);
+      const int64_t searchEnd = seek_pos + MIN(interval / 2, THUMB_SCENE_WINDOW / timebaseDouble);
+
+      // Read and decode frame
+      while(av_read_frame(pFormatCtx, &packet) >= 0) {
+        @try {
+          // Make sure it's video stream
+          if (packet.stream_index == videoStream) {
+
+            // In keyframe only mode skip to the first keyframe, which is normally the first packet
+            if (keyframesOnly && !(packet.flags & AV_PKT_FLAG_KEY))
               continue;
-            else
+
+            // Decode video frame
+            const double decodeStart = CACurrentMediaTime();
+            if (avcodec_send_packet(pCodecCtx, &packet) < 0)
               break;
-          }
+            decodedPackets++;
+
+            // Drain the decoder so it outputs the keyframe without being fed any more packets.
+            // The decoder is flushed before the next seek.
+            if (keyframesOnly)
+              avcodec_send_packet(pCodecCtx, NULL);
+
+            ret = avcodec_receive_frame(pCodecCtx, pFrame);
+            decodeTime += CACurrentMediaTime() - decodeStart;
+            if (ret < 0) {  // something happened
+              if (ret == AVERROR(EAGAIN) && !keyframesOnly)  // input not ready, retry
+                continue;
+              else
+                break;
+            }
+
+            // Check if duplicated within this segment, duplicates across segments are dropped when
+            // the results are delivered. In scene aware mode look for another frame instead.
+            decodedFrames++;
+            NSNumber *currentTimeStamp = @(pFrame->best_effort_timestamp);
+            const BOOL duplicate = [addedTimestamps containsObject:currentTimeStamp];
+            if (sceneAware) {
+              if (decodedFrames > 1 && (decodedFrames >= THUMB_SCENE_MAX_FRAMES ||
+                                        pFrame->best_effort_timestamp > searchEnd))
+                break;
+              if (duplicate || (decodedFrames - 1) % THUMB_SCENE_FRAME_STEP != 0)
+                continue;
+            } else if (duplicate) {
+              break;
+            } else {
+              [addedTimestamps addObject:currentTimeStamp];
+            }
+            uint8_t *pixels = sceneAware ? candidatePixels.mutableBytes : [thumbnailBuffer pixelsAtIndex:i];
 
-          // Check if duplicated
-          NSNumber *currentTimeStamp = @(pFrame->best_effort_timestamp);
-          if ([_addedTimestamps containsObject:currentTimeStamp]) {
-            double currentTime = CACurrentMediaTime();
-            if (currentTime - _timestamp > 1) {
-              if (self.delegate) {
-                [self.delegate didUpdateThumbnails:NULL forFile: file withProgress: i];
-                _timestamp = currentTime;
+            // Convert the frame to RGBA, using the thumbnail kernel for the formats it supports
+            if (thumbnailScalerSupportsFrame(pFrame)) {
+#if DEBUG
+              if (!verifiedScaler) {
+                verifyThumbnailScaler(pFrame, thumbWidth, thumbHeight);
+                verifiedScaler = YES;
+              }
+#endif
+              ret = thumbnailScale(pFrame, pixels, thumbWidth, thumbHeight, (int)thumbnailBuffer.bytesPerRow);
+              CHECK_SUCCESS(ret, @"Cannot scale frame")
+            } else {
+              if (!sws_ctx || pFrame->width != swsWidth || pFrame->height != swsHeight ||
+                  pFrame->format != swsFormat) {
+                [pool recycleScaler:sws_ctx];
+                sws_ctx = [pool scalerFromWidth:pFrame->width height:pFrame->height format:pFrame->format
+                                        toWidth:pFrameRGB->width height:pFrameRGB->height format:pFrameRGB->format
+                                          flags:SWS_BILINEAR];
+                CHECK_NOTNULL(sws_ctx, @"Cannot create sws context")
+                swsWidth = pFrame->width;
+                swsHeight = pFrame->height;
+                swsFormat = pFrame->format;
               }
+              pFrameRGB->data[0] = pixels;
+              ret = sws_scale(sws_ctx,
+                              (const uint8_t* const *)pFrame->data,
+                              pFrame->linesize,
+                              0,
+                              pFrame->height,
+                              pFrameRGB->data,
+                              pFrameRGB->linesize);
+              CHECK_SUCCESS(ret, @"Cannot convert frame")
             }
+
+            if (sceneAware) {
+              // Keep the frame if it is better than the ones before, stop looking once it is neither
+              // blank nor a duplicate of a neighbour
+              NSData *signature = thumbnailSignature(pixels, thumbWidth, thumbHeight, thumbnailBuffer.bytesPerRow);
+              const double score = MIN(signatureDeviation(signature) / THUMB_BLANK_DEVIATION,
+                                       [self differenceToNeighboursOfIndex:i signature:signature] /
+                                       THUMB_DUPLICATE_DIFFERENCE);
+              if (score > bestScore) {
+                memcpy([thumbnailBuffer pixelsAtIndex:i], pixels, slotSize);
+                bestScore = score;
+                bestTimestamp = pFrame->best_effort_timestamp;
+              }
+              if (score >= 1)
+                break;
+              continue;
+            }
+
+            // Add the thumbnail
+            [self saveThumbnailAtIndex:i
+                              realTime:(pFrame->best_effort_timestamp * timebaseDouble)
+                             timestamp:pFrame->best_effort_timestamp
+                               forFile:file];
+            saved = YES;
             break;
-          } else {
-            [_addedTimestamps addObject:currentTimeStamp];
           }
-
-          // Convert the frame to RGBA
-          ret = sws_scale(sws_ctx,
-                          (const uint8_t* const *)pFrame->data,
-                          pFrame->linesize,
-                          0,
-                          pCodecCtx->height,
-                          pFrameRGB->data,
-                          pFrameRGB->linesize);
-          CHECK_SUCCESS(ret, @"Cannot convert frame")
-
-          // Save the frame to disk
-          [self saveThumbnail:pFrameRGB
-                        width:pFrameRGB->width
-                       height:pFrameRGB->height
-                        index:i
-                     realTime:(pFrame->best_effort_timestamp * timebaseDouble)
-                      forFile:file];
-          break;
+        } @finally {
+          // Free the packet
+          av_packet_unref(&packet);
         }
-      } @finally {
-        // Free the packet
-        av_packet_unref(&packet);
+      }
+      if (sceneAware && bestScore >= 0) {
+        // Only the frame that is kept counts as added, later points may still choose the other candidates
+        [addedTimestamps addObject:@(bestTimestamp)];
+        [self saveThumbnailAtIndex:i realTime:(bestTimestamp * timebaseDouble) timestamp:bestTimestamp forFile:file];
+        saved = YES;
+      }
+      if (sceneAware && decodedFrames > 1) {
+        extraFrames += decodedFrames - 1;
+      }
+      if (!saved) {
+        [self skipThumbnailAtIndex:i forFile:file];
       }
     }
+
+    // LOG_DEBUG(@"Thumbnails generated.");
+    return 0;
   }
-  // Free the scaler
-  sws_freeContext(sws_ctx);
+  @finally {
+    [_resultLock lock];
+    _decodedPacketCount += decodedPackets;
+    _extraFrameCount += extraFrames;
+    _decodeTime += decodeTime;
+    _coalescedPointCount += coalescedPoints;
+    if (throttledInput) {
+      _networkBytesRead += throttledInput->bytesRead;
+    }
+    [_resultLock unlock];
 
-  // Free the RGB image
-  av_free(pFrameRGBBuffer);
-  av_frame_free(&pFrameRGB);
-  // Free the YUV frame
-  av_frame_free(&pFrame);
+    // Return the scaler and frames to the pool, the data of the RGB frame belongs to the thumbnail
+    // buffer. All of these methods accept null.
+    [pool recycleScaler:sws_ctx];
+    [pool recycleFrame:pFrameRGB];
+    [pool recycleFrame:pFrame];
 
-  // Free the codec
-  avcodec_free_context(&pCodecCtx);
-  // Close the video file
-  avformat_close_input(&pFormatCtx);
+    av_dict_free(&optionsDict);
+    // Free the codec
+    avcodec_free_context(&pCodecCtx);
+    // Close the video file, then the input it was read from in network mode
+    avformat_close_input(&pFormatCtx);
+    closeThrottledInput(&throttledInput);
+  }
+}
+
+
+/// Returns the number of intervals to divide the timeline of the given file into.
+///
+/// More preview points than the mouse can select on the seek bar, or more than one per second, only add decoding work. Videos
+/// whose scenes change rarely get fewer preview points, as neighbouring thumbnails would look alike. Encoders place keyframes at
+/// scene changes, so the keyframe rate found in the index of the demuxer serves as the scene change rate without decoding
+/// anything. The result is rounded so small changes of the seek bar width keep the partial results of an interrupted job usable.
+///
+/// Some demuxers, such as the Matroska one, only read the index the first time the file is seeked, so the file is seeked once if
+/// the index is empty. Formats without an index, such as MPEG-TS, keep a scene factor of 1.
+///
+/// The file is opened the same way the workers open it and kept in `_jobFormatContext` for the worker of the first segment.
+- (NSInteger)adaptiveThumbnailCountForFile:(NSString *)file
+{
+  AVFormatContext *pFormatCtx = NULL;
+  int ret = avformat_open_input(&pFormatCtx, file.fileSystemRepresentation, NULL, NULL);
+  if (ret < 0) {
+    LOG_ERROR(@"Error when opening file %@ to choose thumbnail count: %s (%d)", file, av_err2str(ret), ret);
+    return self.thumbnailCount;
+  }
+  ret = avformat_find_stream_info(pFormatCtx, NULL);
+  if (ret < 0) {
+    LOG_ERROR(@"Error when reading stream info of %@ to choose thumbnail count: %s (%d)", file, av_err2str(ret), ret);
+    avformat_close_input(&pFormatCtx);
+    return self.thumbnailCount;
+  }
+  const double seconds = pFormatCtx->duration > 0 ? (double)pFormatCtx->duration / AV_TIME_BASE : 0;
+  int keyframes = 0;
+  const int videoStream = av_find_best_stream(pFormatCtx, AVMEDIA_TYPE_VIDEO, -1, -1, NULL, 0);
+  if (videoStream >= 0) {
+    AVStream *pVideoStream = pFormatCtx->streams[videoStream];
+    if (avformat_index_get_entries_count(pVideoStream) <= 1) {
+      av_seek_frame(pFormatCtx, videoStream, 0, AVSEEK_FLAG_BACKWARD);
+    }
+    const int entries = avformat_index_get_entries_count(pVideoStream);
+    for (int i = 0; i < entries; i++) {
+      if (avformat_index_get_entry(pVideoStream, i)->flags & AVINDEX_KEYFRAME) {
+        keyframes++;
+      }
+    }
+  }
+  [_resultLock lock];
+  avformat_close_input(&_jobFormatContext);
+  _jobFormatContext = pFormatCtx;
+  [_resultLock unlock];
+  if (seconds <= 0) {
+    return self.thumbnailCount;
+  }
 
-  // LOG_DEBUG(@"Thumbnails generated.");
-  return 0;
+  double count = MIN((double)self.thumbnailSeekBarWidth / THUMB_POINTS_PER_PREVIEW, seconds / THUMB_MIN_INTERVAL);
+  double sceneFactor = 1;
+  if (keyframes > 1) {
+    sceneFactor = MIN(MAX(THUMB_SCENE_INTERVAL / (seconds / keyframes), 0.5), 1);
+    count *= sceneFactor;
+  }
+  const NSInteger result = count < THUMB_COUNT_STEP ? MAX((NSInteger)ceil(count), 1) :
+      (NSInteger)round(count / THUMB_COUNT_STEP) * THUMB_COUNT_STEP;
+  LOG_DEBUG(@"Using %ld thumbnail intervals for %.0fs of video, seek bar width %ld, %d keyframes, scene factor %.2f",
+            (long)result, seconds, (long)self.thumbnailSeekBarWidth, keyframes, sceneFactor);
+  return result;
 }
 
+/// Returns the buffer the thumbnails of the current job are stored in, creating it on first use.
+- (FFThumbnailBuffer *)thumbnailBufferWithWidth:(int)width height:(int)height
+{
+  [_resultLock lock];
+  if (!_thumbnailBuffer) {
+    _thumbnailBuffer = [[FFThumbnailBuffer alloc] initWithWidth:width height:height
+                                                       capacity:_pendingThumbnails.count];
+  }
+  FFThumbnailBuffer *buffer = _thumbnailBuffer;
+  [_resultLock unlock];
+  return buffer;
+}
 
-- (void)saveThumbnail:(AVFrame *)pFrame width
-                     :(int)width height
-                     :(int)height index
-                     :(int)index realTime
-                     :(int)second forFile
-                     :(NSString *)file
+- (void)saveThumbnailAtIndex:(int)index realTime:(int)second timestamp:(int64_t)timestamp forFile:(NSString *)file
 {
-  // Create CGImage
-  CGColorSpaceRef rgb = CGColorSpaceCreateDeviceRGB();
+  FFThumbnail *tb = [[FFThumbnail alloc] initWithBuffer:_thumbnailBuffer index:index realTime:second];
+  // Signatures are compared with those of the neighbours in scene aware sampling, debug builds also use them to measure
+  // the quality of the thumbnails
+#if DEBUG
+  const BOOL sign = YES;
+#else
+  const BOOL sign = self.thumbnailSceneAware && !self.thumbnailKeyframesOnly && !self.thumbnailNetworkMode;
+#endif
+  NSData *signature = sign ? thumbnailSignature([_thumbnailBuffer pixelsAtIndex:index], _thumbnailBuffer.width,
+                                                _thumbnailBuffer.height, _thumbnailBuffer.bytesPerRow) : nil;
+  [_resultLock lock];
+  if (signature) {
+    _signatures[@(index)] = signature;
+    [_signedIndexes addIndex:index];
+  }
+  _pendingThumbnails[index] = tb;
+  _pendingTimestamps[index] = @(timestamp);
+  [self finishIndex:index];
+  [_resultLock unlock];
+  [self deliverFinishedThumbnailsForFile:file];
+}
 
-  CGContextRef cgContext = CGBitmapContextCreate(pFrame->data[0],  // it's converted to RGBA so could be used directly
-                                                 width, height,
-                                                 8,  // 8 bit per component
-                                                 width * 4,  // 4 bytes(rgba) per pixel
-                                                 rgb,
-                                                 kCGImageAlphaPremultipliedLast);
-  CGImageRef cgImage = CGBitmapContextCreateImage(cgContext);
-
-  // Create NSImage
-  NSImage *image = [[NSImage alloc] initWithCGImage:cgImage size: NSZeroSize];
-
-  // Free resources
-  CFRelease(rgb);
-  CFRelease(cgContext);
-  CFRelease(cgImage);
-
-  // Add to list
-  FFThumbnail *tb = [[FFThumbnail alloc] init];
-  tb.image = image;
-  tb.realTime = second;
-  [_thumbnails addObject:tb];
-  [_thumbnailPartialResult addObject:tb];
-  // Post update notification
-  double currentTime = CACurrentMediaTime();
-  if (currentTime - _timestamp >= 0.2) {  // min notification interval: 0.2s
-    if (_thumbnailPartialResult.count >= 10 || (currentTime - _timestamp >= 1 && _thumbnailPartialResult.count > 0)) {
-      if (self.delegate) {
-        [self.delegate didUpdateThumbnails:[NSArray arrayWithArray:_thumbnailPartialResult]
-                                   forFile: file
-                              withProgress: index];
+- (void)skipThumbnailAtIndex:(int)index forFile:(NSString *)file
+{
+  [_resultLock lock];
+  [self finishIndex:index];
+  [_resultLock unlock];
+  [self deliverFinishedThumbnailsForFile:file];
+}
+
+/// Mark the given preview point as processed, whether or not it produced a thumbnail.
+/// - Important: Must be called while holding `_resultLock`.
+- (void)finishIndex:(int)index
+{
+  if ([_finishedIndexes containsIndex:index]) return;
+  [_finishedIndexes addIndex:index];
+  [_finishOrder addObject:@(index)];
+}
+
+/// Returns the smallest difference between the given signature and those of the closest saved thumbnails before and
+/// after the given preview point, or `DBL_MAX` if there are none.
+- (double)differenceToNeighboursOfIndex:(int)index signature:(NSData *)signature
+{
+  double difference = DBL_MAX;
+  [_resultLock lock];
+  const NSUInteger before = [_signedIndexes indexLessThanIndex:index];
+  const NSUInteger after = [_signedIndexes indexGreaterThanIndex:index];
+  if (before != NSNotFound) {
+    difference = MIN(difference, signatureDifference(signature, _signatures[@(before)]));
+  }
+  if (after != NSNotFound) {
+    difference = MIN(difference, signatureDifference(signature, _signatures[@(after)]));
+  }
+  [_resultLock unlock];
+  return difference;
+}
+
+#if DEBUG
+/// Returns how many of every 100 thumbnails are neither blank nor a duplicate of the thumbnail before them, as a measure
+/// of the quality of the thumbnails.
+- (double)distinctThumbnailsPerHundred
+{
+  __block NSData *previous = nil;
+  __block NSUInteger distinct = 0;
+  [_resultLock lock];
+  [_signedIndexes enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+    NSData *signature = self->_signatures[@(index)];
+    if (signatureDeviation(signature) >= THUMB_BLANK_DEVIATION &&
+        (!previous || signatureDifference(signature, previous) >= THUMB_DUPLICATE_DIFFERENCE)) {
+      distinct++;
+    }
+    previous = signature;
+  }];
+  const NSUInteger count = _signedIndexes.count;
+  [_resultLock unlock];
+  return count == 0 ? 0 : distinct * 100.0 / count;
+}
+#endif
+
+/// Deliver the results of preview points that have been processed.
+///
+/// In linear order results are delivered up to the first preview point that is still being processed. This keeps the thumbnails
+/// passed to the delegate in timeline order no matter which segment produced them first.
+- (void)deliverFinishedThumbnailsForFile:(NSString *)file
+{
+  NSMutableArray<dispatch_block_t> *notifications = [[NSMutableArray alloc] init];
+  [_resultLock lock];
+  const BOOL progressive = self.thumbnailProgressiveOrder;
+  const NSInteger thumbnailCount = _jobThumbnailCount;
+  while (progressive ? _deliveryPosition < _finishOrder.count :
+         (_deliveryPosition < _pendingThumbnails.count && [_finishedIndexes containsIndex:_deliveryPosition])) {
+    const int index = progressive ? _finishOrder[_deliveryPosition].intValue : _deliveryPosition;
+    _deliveryPosition++;
+    // In progressive order progress is the number of processed points rather than a position
+    const int progress = progressive ? _deliveryPosition : index;
+    id result = _pendingThumbnails[index];
+    _pendingThumbnails[index] = [NSNull null];
+    NSNumber *currentTimeStamp = _pendingTimestamps[index];
+    double currentTime = CACurrentMediaTime();
+    const BOOL reportable = !_refining && ![_resumedIndexes containsIndex:index] && ![_abandonedIndexes containsIndex:index];
+    if (reportable) {
+      [_processedIndexes addIndex:index];
+    }
+    // Check if duplicated
+    if (result == [NSNull null] ||
+        (currentTimeStamp != (id)[NSNull null] && [_addedTimestamps containsObject:currentTimeStamp])) {
+      if (currentTime - _timestamp > 1) {
+        if (self.delegate && !_refining) {
+          [self reportProcessedPointsForFile:file into:notifications];
+          [notifications addObject:^{
+            [self.delegate didUpdateThumbnails:NULL forFile:file withProgress:progress thumbnailCount:thumbnailCount];
+          }];
+          _timestamp = currentTime;
+        }
+      }
+      continue;
+    }
+    if (currentTimeStamp != (id)[NSNull null]) {
+      [_addedTimestamps addObject:currentTimeStamp];
+    }
+    if (reportable) {
+      _processedThumbnails[@(index)] = result;
+    }
+    [_coveredIndexes addIndex:index];
+    [_thumbnails addObject:result];
+    [_thumbnailPartialResult addObject:result];
+    // Post update notification
+    if (currentTime - _timestamp >= 0.2 && !_refining) {  // min notification interval: 0.2s
+      if (_thumbnailPartialResult.count >= 10 || (currentTime - _timestamp >= 1 && _thumbnailPartialResult.count > 0)) {
+        if (self.delegate) {
+          [self reportProcessedPointsForFile:file into:notifications];
+          NSArray<FFThumbnail *> *thumbnails = [NSArray arrayWithArray:_thumbnailPartialResult];
+          [notifications addObject:^{
+            [self.delegate didUpdateThumbnails:thumbnails
+                                       forFile:file
+                                  withProgress:progress
+                                thumbnailCount:thumbnailCount];
+          }];
+        }
+        [_thumbnailPartialResult removeAllObjects];
+        _timestamp = currentTime;
+#if DEBUG
+        LOG_DEBUG(@"Largest gap in thumbnail coverage is %.1f%% after %.2fs", [self largestCoverageGap] * 100,
+                  currentTime - _jobStartTime);
+#endif
       }
-      [_thumbnailPartialResult removeAllObjects];
-      _timestamp = currentTime;
     }
   }
+  [self unlockResultsAndNotify:notifications];
 }
 
+/// Add a notification about the preview points processed since the delegate was last told about them.
+/// - Important: Must be called while holding `_resultLock`.
+- (void)reportProcessedPointsForFile:(NSString *)file into:(NSMutableArray<dispatch_block_t> *)notifications
+{
+  if (_processedIndexes.count == 0) return;
+  if ([self.delegate respondsToSelector:@selector(didProcessThumbnailPoints:thumbnails:thumbnailCount:forFile:)]) {
+    NSIndexSet *points = [_processedIndexes copy];
+    NSDictionary<NSNumber *, FFThumbnail *> *thumbnails = [_processedThumbnails copy];
+    const NSInteger thumbnailCount = _jobThumbnailCount;
+    [notifications addObject:^{
+      [self.delegate didProcessThumbnailPoints:points
+                                    thumbnails:thumbnails
+                                thumbnailCount:thumbnailCount
+                                       forFile:file];
+    }];
+  }
+  [_processedIndexes removeAllIndexes];
+  [_processedThumbnails removeAllObjects];
+}
+
+/// Release `_resultLock`, then run the given delegate notifications in order.
+///
+/// The delegate sorts the thumbnails it is given into its index, which would block every segment worker if it was done while
+/// holding `_resultLock`.
+/// - Important: Must be called while holding `_resultLock`.
+- (void)unlockResultsAndNotify:(NSArray<dispatch_block_t> *)notifications
+{
+  if (notifications.count == 0) {
+    [_resultLock unlock];
+    return;
+  }
+  [_notificationLock lock];
+  [_resultLock unlock];
+  for (dispatch_block_t notification in notifications) {
+    notification();
+  }
+  [_notificationLock unlock];
+}
+
+#if DEBUG
+/// Returns the largest distance between preview points that have a thumbnail, as a fraction of the timeline.
+/// - Important: Must be called while holding `_resultLock`.
+- (double)largestCoverageGap
+{
+  const NSInteger lastIndex = (NSInteger)_pendingThumbnails.count - 1;
+  if (lastIndex <= 0 || _coveredIndexes.count == 0) return 1;
+  __block NSInteger previous = 0;
+  __block NSInteger largest = 0;
+  [_coveredIndexes enumerateIndexesUsingBlock:^(NSUInteger index, BOOL *stop) {
+    largest = MAX(largest, (NSInteger)index - previous);
+    previous = index;
+  }];
+  largest = MAX(largest, lastIndex - previous);
+  return (double)largest / lastIndex;
+}
+#endif
+
 // MARK: - Probing Video
 
+/// Statistics of the tiers of `probeVideoInfoForFile:` by format and tier, see `probeStatistics`.
+static NSMutableDictionary<NSString *, NSMutableArray<NSNumber *> *> *probeStatistics;
+static NSLock *probeStatisticsLock;
+
+static void recordProbe(const AVFormatContext *pFormatCtx, int tier, double time, int64_t bytesRead)
+{
+  static dispatch_once_t onceToken;
+  dispatch_once(&onceToken, ^{
+    probeStatistics = [[NSMutableDictionary alloc] init];
+    probeStatisticsLock = [[NSLock alloc] init];
+  });
+  NSString *key = [NSString stringWithFormat:@"%s tier %d", pFormatCtx->iformat->name, tier];
+  [probeStatisticsLock lock];
+  NSMutableArray<NSNumber *> *statistics = probeStatistics[key];
+  if (!statistics) {
+    statistics = [@[@0, @0.0, @0] mutableCopy];
+    probeStatistics[key] = statistics;
+  }
+  statistics[0] = @(statistics[0].intValue + 1);
+  statistics[1] = @(statistics[1].doubleValue + time);
+  statistics[2] = @(statistics[2].longLongValue + bytesRead);
+  [probeStatisticsLock unlock];
+}
+
+static int64_t bytesReadByContext(const AVFormatContext *pFormatCtx)
+{
+  return pFormatCtx->pb ? pFormatCtx->pb->bytes_read : 0;
+}
+
 + (NSDictionary *)probeVideoInfoForFile:(nonnull NSString *)file
 {
   int ret;
   int64_t duration;
+  const double startTime = CACurrentMediaTime();
+  int64_t bytesRead = 0;
+  int tier = 1;
 
   char *cFilename = strdup(file.fileSystemRepresentation);
 
   AVFormatContext *pFormatCtx = NULL;
   ret = avformat_open_input(&pFormatCtx, cFilename, NULL, NULL);
-  free(cFilename);
   if (ret < 0) {
     LOG_ERROR(@"Error when opening file %@ to obtain info: %s (%d)", file, av_err2str(ret), ret);
+    free(cFilename);
     return NULL;
   }
 
+  // Tier 1: the duration stored in the container, such as the MP4 mvhd box, the Matroska Duration
+  // element or the Xing and VBRI headers of MP3, which the demuxer reads when the file is opened
   duration = pFormatCtx->duration;
+
+  // Tier 2: the duration libavformat estimates from the first packets, with limits that are enough
+  // for an estimate but not for the details of every stream
   if (duration <= 0) {
+    tier = 2;
+    pFormatCtx->probesize = PROBE_DURATION_PROBESIZE;
+    pFormatCtx->max_analyze_duration = PROBE_DURATION_ANALYZE_DURATION;
     ret = avformat_find_stream_info(pFormatCtx, NULL);
+    duration = ret < 0 ? -1 : pFormatCtx->duration;
+  }
+
+  // Tier 3: a full probe with the default limits, as a last resort. A fresh context is used as
+  // stream info cannot be found again, the metadata is still taken from the first one.
+  if (duration <= 0) {
+    tier = 3;
+    AVFormatContext *pFullFormatCtx = NULL;
+    ret = avformat_open_input(&pFullFormatCtx, cFilename, NULL, NULL);
+    if (ret >= 0) {
+      ret = avformat_find_stream_info(pFullFormatCtx, NULL);
+      duration = ret < 0 ? -1 : pFullFormatCtx->duration;
+      bytesRead += bytesReadByContext(pFullFormatCtx);
+      avformat_close_input(&pFullFormatCtx);
+    }
     if (ret < 0) {
       LOG_ERROR(@"Error when probing %@ to obtain info: %s (%d)", file, av_err2str(ret), ret);
-      duration = -1;
-    } else
-      duration = pFormatCtx->duration;
+    }
   }
+  free(cFilename);
+  if (duration <= 0)
+    duration = -1;
+
+  bytesRead += bytesReadByContext(pFormatCtx);
+  const double probeTime = CACurrentMediaTime() - startTime;
+  recordProbe(pFormatCtx, tier, probeTime, bytesRead);
+  LOG_DEBUG(@"Probed %@ (%s) in tier %d: %.2fms, %lld bytes read", file.lastPathComponent, pFormatCtx->iformat->name,
+            tier, probeTime * 1000, bytesRead);
 
   NSMutableDictionary *info = [[NSMutableDictionary alloc] init];
   info[@"@iina_duration"] = duration == -1 ? [NSNumber numberWithInt:-1] : [NSNumber numberWithDouble:(double)duration / AV_TIME_BASE];
@@ -376,12 +1675,49 @@ return -1;\
   while ((tag = av_dict_get(pFormatCtx->metadata, "", tag, AV_DICT_IGNORE_SUFFIX)))
     info[[NSString stringWithCString:tag->key encoding:NSUTF8StringEncoding]] = [NSString stringWithCString:tag->value encoding:NSUTF8StringEncoding];
 
+  // Summarize the streams and name the codec of the main stream, the first video stream that is not
+  // cover art or else the first audio stream
+  int streamCounts[AVMEDIA_TYPE_NB] = {0};
+  const AVCodecParameters *mainStream = NULL;
+  for (unsigned int i = 0; i < pFormatCtx->nb_streams; i++) {
+    const AVStream *stream = pFormatCtx->streams[i];
+    const enum AVMediaType type = stream->codecpar->codec_type;
+    if (type < 0 || type >= AVMEDIA_TYPE_NB || (stream->disposition & AV_DISPOSITION_ATTACHED_PIC))
+      continue;
+    streamCounts[type]++;
+    if (type == AVMEDIA_TYPE_VIDEO && (!mainStream || mainStream->codec_type != AVMEDIA_TYPE_VIDEO))
+      mainStream = stream->codecpar;
+    else if (type == AVMEDIA_TYPE_AUDIO && !mainStream)
+      mainStream = stream->codecpar;
+  }
+  NSMutableArray<NSString *> *streams = [[NSMutableArray alloc] init];
+  for (int type = 0; type < AVMEDIA_TYPE_NB; type++) {
+    if (streamCounts[type] > 0)
+      [streams addObject:[NSString stringWithFormat:@"%d %s", streamCounts[type], av_get_media_type_string(type)]];
+  }
+  info[@"@iina_streams"] = [streams componentsJoinedByString:@", "];
+  if (mainStream)
+    info[@"@iina_codec"] = @(avcodec_get_name(mainStream->codec_id));
+
   avformat_close_input(&pFormatCtx);
   avformat_free_context(pFormatCtx);
 
   return info;
 }
 
++ (NSDictionary<NSString *, NSString *> *)probeStatistics
+{
+  NSMutableDictionary<NSString *, NSString *> *result = [[NSMutableDictionary alloc] init];
+  [probeStatisticsLock lock];
+  [probeStatistics enumerateKeysAndObjectsUsingBlock:^(NSString *key, NSMutableArray<NSNumber *> *statistics, BOOL *stop) {
+    const int count = statistics[0].intValue;
+    result[key] = [NSString stringWithFormat:@"%d files, %.2fms and %lld bytes per file", count,
+                   statistics[1].doubleValue * 1000 / count, statistics[2].longLongValue / count];
+  }];
+  [probeStatisticsLock unlock];
+  return result;
+}
+
 // MARK: - Decoding Image
 
 + (NSImage *)createNSImageWithContentsOfURL:(nonnull NSURL *)url
@@ -392,8 +1728,8 @@ return -1;\
   AVPacket *packet = NULL;
   AVFrame *pFrame = NULL;
   AVFrame *pFrameRGB = NULL;
-  uint8_t *pFrameRGBBuffer = NULL;
   struct SwsContext *swsContext = NULL;
+  FFResourcePool *pool = [FFResourcePool sharedPool];
   CGColorSpaceRef cgColorSpace = NULL;
   CGContextRef cgContext = NULL;
   CGImageRef cgImage = NULL;
@@ -489,7 +1825,7 @@ return -1;\
       return NULL;
     }
 
-    pFrame = av_frame_alloc();
+    pFrame = [pool frame];
     if (!pFrame) {
       LOG_ERROR(@"Cannot alloc frame");
       return NULL;
@@ -511,15 +1847,8 @@ return -1;\
 #endif
 
     // CGImage requires the image frame to be converted to RGBA.
-    pFrameRGB = av_frame_alloc();
-    if (!pFrameRGB) {
-      LOG_ERROR(@"Cannot alloc RGBA frame");
-      return NULL;
-    }
-    pFrameRGB->width = pFrame->width;
-    pFrameRGB->height = pFrame->height;
-
     // Determine the appropriate RGBA pixel format to convert to.
+    enum AVPixelFormat rgbFormat;
     CGBitmapInfo bitmapInfo;
     switch (pFrame->format) {
       default:
@@ -531,7 +1860,7 @@ return -1;\
       case AV_PIX_FMT_RGB24: // JPEG XL SDR video.
       case AV_PIX_FMT_RGBA64LE: // JPEG XL SDR video.
       case AV_PIX_FMT_YUV420P: // WebP default.
-        pFrameRGB->format = AV_PIX_FMT_RGBA;
+        rgbFormat = AV_PIX_FMT_RGBA;
         bitmapInfo = (CGBitmapInfo)kCGImageAlphaPremultipliedLast;
         break;
       case AV_PIX_FMT_RGB48LE: // JPEG XL HDR video.
@@ -541,30 +1870,22 @@ return -1;\
         // call to sws_getContext returned NULL. The scalar printed the message "rgbaf16le is not
         // supported as output pixel format" to the console. As a workaround we convert to
         // AV_PIX_FMT_RGBA64LE and then convert the components to floating point.
-        pFrameRGB->format = AV_PIX_FMT_RGBA64LE;
+        rgbFormat = AV_PIX_FMT_RGBA64LE;
         bitmapInfo = kCGImageByteOrder16Little | kCGImageAlphaPremultipliedLast |
             kCGBitmapFloatComponents;
     }
 
-    // Determine required buffer size and allocate the buffer.
-    const int size = av_image_get_buffer_size(pFrameRGB->format, pFrame->width, pFrame->height, 1);
-    pFrameRGBBuffer = (uint8_t *)av_malloc(size);
-    if (!pFrameRGBBuffer) {
-      LOG_ERROR(@"Cannot alloc RGBA buffer");
-      return NULL;
-    }
-
-    // Assign appropriate parts of buffer to image planes in pFrameRGB.
-    ret = av_image_fill_arrays(pFrameRGB->data, pFrameRGB->linesize, pFrameRGBBuffer,
-        pFrameRGB->format, pFrameRGB->width, pFrameRGB->height, 1);
-    if (ret < 0) {
-      LOG_ERROR(@"Cannot fill data for RGBA frame: %s (%d)", av_err2str(ret), ret);
+    // Get a frame with an unpadded buffer of the required size from the pool.
+    pFrameRGB = [pool frameWithFormat:rgbFormat width:pFrame->width height:pFrame->height];
+    if (!pFrameRGB) {
+      LOG_ERROR(@"Cannot alloc RGBA frame");
       return NULL;
     }
 
     // Convert the image frame to RGBA using the FFmpeg scaler.
-    swsContext = sws_getContext(pFrame->width, pFrame->height, pFrame->format,
-        pFrameRGB->width, pFrameRGB->height, pFrameRGB->format, SWS_BILINEAR, NULL, NULL, NULL);
+    swsContext = [pool scalerFromWidth:pFrame->width height:pFrame->height format:pFrame->format
+                               toWidth:pFrameRGB->width height:pFrameRGB->height format:pFrameRGB->format
+                                 flags:SWS_BILINEAR];
     if (!swsContext) {
       LOG_ERROR(@"Cannot alloc sws context");
       return NULL;
@@ -687,10 +2008,9 @@ return -1;\
     CGImageRelease(cgImage);
     CGContextRelease(cgContext);
     CGColorSpaceRelease(cgColorSpace);
-    sws_freeContext(swsContext);
-    av_freep(&pFrameRGBBuffer);
-    av_frame_free(&pFrameRGB);
-    av_frame_free(&pFrame);
+    [pool recycleScaler:swsContext];
+    [pool recycleFrame:pFrameRGB];
+    [pool recycleFrame:pFrame];
     av_packet_free(&packet);
     avcodec_free_context(&pCodecCtx);
     avformat_close_input(&pFormatCtx);
@@ -25,4 +25,9 @@ class MPVChapter: NSObject {
     self.index = index
   }
 
+  /// Create a chapter from an entry of the `chapter-list` property read as a node.
+  convenience init(node: [String: Any?], index: Int) {
+    self.init(title: node.string("title"), startTime: node.double("time") ?? 0, index: index)
+  }
+
 }
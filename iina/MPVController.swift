@@ -78,6 +78,8 @@ struct MPVHookValue {
 class MPVController: NSObject {
   struct UserData {
     static let screenshot: UInt64 = 1000000
+    /// The first of the reply userdata values of `loadFiles(_:level:)`, every call uses the next value.
+    static let loadfileBatch: UInt64 = 2000000
   }
 
   /// Version number of the libass library.
@@ -99,12 +101,28 @@ class MPVController: NSObject {
 
   var mpvVersion: String { getString(MPVProperty.mpvVersion)! }
 
-  /// [DispatchQueue](https://developer.apple.com/documentation/dispatch/dispatchqueue) for reading `mpv`
-  /// events.
+  /// Thread for reading `mpv` events.
+  ///
+  /// The thread sleeps until the mpv wakeup callback signals `eventSemaphore`, then reads the pending events in batches of at most
+  /// `maxEventsPerBatch`. Log messages are copied and passed to `logQueue` once per batch, so converting and writing them does
+  /// not delay the handling of other events.
   ///
   /// - Important: To avoid using locking to prevent data races the convention is that processing involving data used by the UI is
-  ///     never performed while running on this queue's thread and instead is queued for processing by the main thread .
-  lazy var queue = DispatchQueue(label: "com.colliderli.iina.controller", qos: .userInitiated)
+  ///     never performed while running on this thread and instead is queued for processing by the main thread .
+  private var eventThread: Thread?
+  private let eventSemaphore = DispatchSemaphore(value: 0)
+  private static let maxEventsPerBatch = 64
+
+  /// [DispatchQueue](https://developer.apple.com/documentation/dispatch/dispatchqueue) for logging `mpv` log messages.
+  private let logQueue = DispatchQueue(label: "com.colliderli.iina.controller.log", qos: .utility)
+
+  /// Time of the first wakeup callback whose events have not been read yet.
+  @Atomic private var wakeupTime: CFTimeInterval?
+
+  // Time from the wakeup callback to the start of the handling of the first event read after it, only accessed on `eventThread`.
+  private var eventLatencyCount = 0
+  private var eventLatencyTotal: CFTimeInterval = 0
+  private var eventLatencyMax: CFTimeInterval = 0
 
   unowned let player: PlayerCore
 
@@ -115,6 +133,52 @@ class MPVController: NSObject {
   @Atomic private var hooks: [UInt64: MPVHookValue] = [:]
   private var hookCounter: UInt64 = 1
 
+  /// Minimum time between deliveries of changes of `rateLimitedProperties` to the main thread, about one display frame.
+  private static let propertyChangeInterval: TimeInterval = 1.0 / 60
+
+  /// Properties that can change many times a second, such as while a slider is dragged or the speed is ramped.
+  private static let rateLimitedProperties: Set<String> = [
+    MPVOption.PlaybackControl.speed,
+    MPVOption.Audio.volume,
+    MPVOption.Audio.audioDelay,
+    MPVOption.Subtitles.subDelay,
+    MPVOption.Subtitles.secondarySubDelay,
+    MPVOption.Subtitles.subScale,
+    MPVOption.Subtitles.subPos,
+    MPVOption.Subtitles.secondarySubPos,
+    MPVOption.Equalizer.contrast,
+    MPVOption.Equalizer.hue,
+    MPVOption.Equalizer.brightness,
+    MPVOption.Equalizer.gamma,
+    MPVOption.Equalizer.saturation,
+    MPVOption.Window.windowScale,
+  ]
+
+  // Property changes waiting to be delivered to the main thread, see `deliverPropertyChange(_:key:_:)`. Protected by
+  // `propertyChangeLock`.
+  private let propertyChangeLock = Lock()
+  private var pendingPropertyChanges: [String: () -> Void] = [:]
+  private var pendingPropertyChangeKeys: [String] = []
+  private var immediateDeliveryScheduled = false
+  private var delayedDeliveryScheduled = false
+  /// Incremented whenever the pending changes are taken, so a delivery scheduled before then does not deliver later changes.
+  private var propertyChangeGeneration = 0
+  private var lastPropertyChangeDelivery: CFTimeInterval = 0
+  private var propertyChangeCounts = (received: 0, delivered: 0, dropped: 0)
+
+  /// Commands sent by a call of `loadFiles(_:level:)` that mpv has not replied to yet, and the number of them that failed.
+  private class LoadfileBatch {
+    let group = DispatchGroup()
+    var pendingCount = 0
+    var errorCount = 0
+    var timedOut = false
+  }
+
+  /// Batches of `loadFiles(_:level:)` waiting for replies by reply userdata. A batch that timed out is kept until the remaining
+  /// replies arrive, as a group must not be released while it has been entered more often than left.
+  @Atomic private var loadfileBatches: [UInt64: LoadfileBatch] = [:]
+  private var loadfileBatchCounter: UInt64 = 0
+
   let observeProperties: [String: mpv_format] = [
     MPVProperty.trackList: MPV_FORMAT_NONE,
     MPVProperty.vf: MPV_FORMAT_NONE,
@@ -566,9 +630,14 @@ class MPVController: NSObject {
     // chkErr(mpv_request_event(mpv, MPV_EVENT_TICK, 1))
 
     // Set a custom function that should be called when there are new events.
+    let eventThread = Thread { [unowned self] in self.readEvents() }
+    eventThread.name = "com.colliderli.iina.controller"
+    eventThread.qualityOfService = .userInitiated
+    eventThread.start()
+    self.eventThread = eventThread
     mpv_set_wakeup_callback(self.mpv, { (ctx) in
       let mpvController = unsafeBitCast(ctx, to: MPVController.self)
-      mpvController.readEvents()
+      mpvController.eventsAvailable()
       }, mutableRawPointerOf(obj: self))
 
     // Observe properties.
@@ -680,6 +749,8 @@ class MPVController: NSObject {
     self.mpvRenderContext = nil
     mpv_destroy(mpv)
     mpv = nil
+    // Let the event thread exit if mpv was destroyed without shutting down
+    eventSemaphore.signal()
   }
 
   func mpvReportSwap() {
@@ -766,9 +837,10 @@ class MPVController: NSObject {
     return mpv_command_string(mpv, rawString)
   }
 
+  @discardableResult
   func asyncCommand(_ command: MPVCommand, args: [String?] = [], checkError: Bool = true,
-                    replyUserdata: UInt64, level: Logger.Level = .debug) {
-    guard mpv != nil else { return }
+                    replyUserdata: UInt64, level: Logger.Level = .debug) -> Int32 {
+    guard mpv != nil else { return MPV_ERROR_UNINITIALIZED.rawValue }
     log("Asynchronously run command: \(command.rawValue) \(args.compactMap{$0}.joined(separator: " "))",
         level: level)
     var cargs = makeCArgs(command, args).map { $0.flatMap { UnsafePointer<CChar>(strdup($0)) } }
@@ -783,6 +855,46 @@ class MPVController: NSObject {
     if checkError {
       chkErr(returnValue)
     }
+    return returnValue
+  }
+
+  /// Run a `loadfile` command with each of the given arguments and wait until mpv has run all of them.
+  ///
+  /// The commands are sent asynchronously, so mpv runs them one after another without waiting for a round trip per command. mpv
+  /// runs asynchronous commands in the order they are sent.
+  /// - Important: Must not be called on the event thread, which receives the replies.
+  /// - Returns: The number of commands that failed.
+  func loadFiles(_ argsList: [[String?]], level: Logger.Level = .verbose) -> Int {
+    guard !argsList.isEmpty else { return 0 }
+    let batch = LoadfileBatch()
+    let replyUserdata = $loadfileBatches.withLock { batches -> UInt64 in
+      loadfileBatchCounter += 1
+      let replyUserdata = UserData.loadfileBatch + loadfileBatchCounter
+      batches[replyUserdata] = batch
+      return replyUserdata
+    }
+    for args in argsList {
+      batch.group.enter()
+      $loadfileBatches.withLock { _ in batch.pendingCount += 1 }
+      if asyncCommand(.loadfile, args: args, checkError: false, replyUserdata: replyUserdata, level: level) < 0 {
+        $loadfileBatches.withLock { _ in
+          batch.pendingCount -= 1
+          batch.errorCount += 1
+        }
+        batch.group.leave()
+      }
+    }
+    let timedOut = batch.group.wait(timeout: .now() + 30) == .timedOut
+    if timedOut {
+      log("Timed out waiting for mpv to load \(argsList.count) files", level: .warning)
+    }
+    return $loadfileBatches.withLock { batches in
+      batch.timedOut = timedOut
+      if batch.pendingCount == 0 {
+        batches.removeValue(forKey: replyUserdata)
+      }
+      return batch.errorCount
+    }
   }
 
   func observe(property: String, format: mpv_format = MPV_FORMAT_DOUBLE) {
@@ -1012,43 +1124,108 @@ class MPVController: NSObject {
 
   // MARK: - Events
 
-  // Read event and handle it async
+  /// Called by mpv on an arbitrary thread when there are new events. Must return quickly and not call the mpv API.
+  private func eventsAvailable() {
+    let now = CACurrentMediaTime()
+    $wakeupTime.withLock { time in
+      if time == nil {
+        time = now
+      }
+    }
+    eventSemaphore.signal()
+  }
+
+  /// Body of `eventThread`, reads events until the mpv core is shutdown.
   private func readEvents() {
-    queue.async {
-      while ((self.mpv) != nil) {
-        let event = mpv_wait_event(self.mpv, 0)!
-        let eventId = event.pointee.event_id
-        // Do not deal with mpv-event-none
-        if eventId == MPV_EVENT_NONE {
-          break
+    while true {
+      eventSemaphore.wait()
+      guard mpv != nil else { return }
+      switch readEventBatch() {
+      case .shutdown:
+        let average = eventLatencyCount > 0 ? eventLatencyTotal / Double(eventLatencyCount) : 0
+        log("Event latency: \(eventLatencyCount) wakeups, average \(String(format: "%.3f", average * 1000))ms, maximum \(String(format: "%.3f", eventLatencyMax * 1000))ms")
+        return
+      case .full:
+        // Come back for the remaining events, mpv only calls the wakeup callback for new events
+        eventSemaphore.signal()
+      case .drained:
+        break
+      }
+    }
+  }
+
+  private enum EventBatchResult {
+    case drained, full, shutdown
+  }
+
+  /// Read and handle at most `maxEventsPerBatch` events.
+  private func readEventBatch() -> EventBatchResult {
+    var logMessages: [(prefix: UnsafeMutablePointer<CChar>, level: UnsafeMutablePointer<CChar>, text: UnsafeMutablePointer<CChar>)] = []
+    defer {
+      if !logMessages.isEmpty {
+        let messages = logMessages
+        // Plugins receive an event per message, as for other events
+        DispatchQueue.main.async { [self] in
+          let eventName = EventController.Name("mpv.\(String(cString: mpv_event_name(MPV_EVENT_LOG_MESSAGE)))")
+          for _ in messages {
+            player.events.emit(eventName)
+          }
         }
-        self.handleEvent(event)
-        // Must stop reading events once the mpv core is shutdown.
-        if eventId == MPV_EVENT_SHUTDOWN {
-          break
+        logQueue.async { [self] in
+          for (prefix, level, text) in messages {
+            let levelName = String(cString: level)
+            log("[\(String(cString: prefix))] \(levelName): \(String(cString: text).trimmingCharacters(in: .newlines))",
+                level: logLevelMap[levelName] ?? .verbose)
+            free(prefix)
+            free(level)
+            free(text)
+          }
         }
       }
     }
+    if let wakeupTime = $wakeupTime.withLock({ time in defer { time = nil }; return time }) {
+      let latency = CACurrentMediaTime() - wakeupTime
+      eventLatencyCount += 1
+      eventLatencyTotal += latency
+      eventLatencyMax = max(eventLatencyMax, latency)
+    }
+    for _ in 0..<MPVController.maxEventsPerBatch {
+      guard mpv != nil else { return .drained }
+      let event = mpv_wait_event(mpv, 0)!
+      let eventId = event.pointee.event_id
+      switch eventId {
+      case MPV_EVENT_NONE:
+        return .drained
+      case MPV_EVENT_LOG_MESSAGE:
+        // The message is freed by mpv on the next call to mpv_wait_event
+        let msg = event.pointee.data.bindMemory(to: mpv_event_log_message.self, capacity: 1).pointee
+        logMessages.append((strdup(msg.prefix)!, strdup(msg.level)!, strdup(msg.text)!))
+      case MPV_EVENT_SHUTDOWN:
+        handleEvent(event)
+        // Must stop reading events once the mpv core is shutdown.
+        return .shutdown
+      default:
+        handleEvent(event)
+      }
+    }
+    return .full
   }
 
   // Handle the event
   private func handleEvent(_ event: UnsafePointer<mpv_event>) {
     let eventId = event.pointee.event_id
 
+    if eventId != MPV_EVENT_PROPERTY_CHANGE {
+      flushPropertyChanges()
+    }
+
     switch eventId {
     case MPV_EVENT_SHUTDOWN:
+      logPropertyChangeCounts()
       DispatchQueue.main.async {
         self.player.mpvHasShutdown()
       }
 
-    case MPV_EVENT_LOG_MESSAGE:
-      let dataOpaquePtr = OpaquePointer(event.pointee.data)
-      let msg = UnsafeMutablePointer<mpv_event_log_message>(dataOpaquePtr)
-      let prefix = String(cString: (msg?.pointee.prefix)!)
-      let level = String(cString: (msg?.pointee.level)!)
-      let text = String(cString: (msg?.pointee.text)!).trimmingCharacters(in: .newlines)
-      log("[\(prefix)] \(level): \(text)", level: logLevelMap[level] ?? .verbose)
-
     case MPV_EVENT_HOOK:
       let userData = event.pointee.reply_userdata
       let hookEvent = event.pointee.data.bindMemory(to: mpv_event_hook.self, capacity: 1).pointee
@@ -1139,6 +1316,20 @@ class MPVController: NSObject {
           return
         }
         DispatchQueue.main.async { self.player.screenshotCallback() }
+      } else if reply > MPVController.UserData.loadfileBatch {
+        let failed = event.pointee.error < 0
+        let batch = $loadfileBatches.withLock { batches -> LoadfileBatch? in
+          guard let batch = batches[reply] else { return nil }
+          if failed {
+            batch.errorCount += 1
+          }
+          batch.pendingCount -= 1
+          if batch.timedOut && batch.pendingCount == 0 {
+            batches.removeValue(forKey: reply)
+          }
+          return batch
+        }
+        batch?.group.leave()
       }
 
     default: break
@@ -1146,8 +1337,8 @@ class MPVController: NSObject {
       // Utility.log("mpv event (unhandled): \(eventName)")
     }
 
-    // This code is running in the com.colliderli.iina.controller dispatch queue. We must not run
-    // plugins from a task in this queue. Accessing EventController data from a thread in this queue
+    // This code is running in the com.colliderli.iina.controller event thread. We must not run
+    // plugins from this thread. Accessing EventController data from this thread
     // results in data races that can cause a crash. See issue 3986.
     DispatchQueue.main.async { [self] in
       let eventName = "mpv.\(String(cString: mpv_event_name(eventId)))"
@@ -1162,39 +1353,39 @@ class MPVController: NSObject {
     switch name {
 
     case MPVProperty.videoParams:
-      DispatchQueue.main.async { self.player.needReloadQuickSettingsView() }
+      deliverPropertyChange(name) { self.player.needReloadQuickSettingsView() }
 
     case MPVProperty.videoParamsRotate:
       guard let rotation = UnsafePointer<Int>(OpaquePointer(property.data))?.pointee else {
         logPropertyValueError(MPVProperty.videoParamsRotate, property.format)
         break
       }
-      DispatchQueue.main.async { self.player.mainWindow.rotation = rotation }
+      deliverPropertyChange(name) { self.player.mainWindow.rotation = rotation }
 
     case MPVProperty.videoParamsPrimaries:
       fallthrough;
 
     case MPVProperty.videoParamsGamma:
-      DispatchQueue.main.async { self.player.refreshEdrMode() }
+      deliverPropertyChange(name) { self.player.refreshEdrMode() }
 
     case MPVOption.TrackSelection.vid:
-      DispatchQueue.main.async { self.player.vidChanged() }
+      deliverPropertyChange(name) { self.player.vidChanged() }
 
     case MPVOption.TrackSelection.aid:
-      DispatchQueue.main.async { self.player.aidChanged() }
+      deliverPropertyChange(name) { self.player.aidChanged() }
 
     case MPVOption.TrackSelection.sid:
-      DispatchQueue.main.async { self.player.sidChanged() }
+      deliverPropertyChange(name) { self.player.sidChanged() }
 
     case MPVOption.Subtitles.secondarySid:
-      DispatchQueue.main.async { self.player.secondarySidChanged() }
+      deliverPropertyChange(name) { self.player.secondarySidChanged() }
 
     case MPVOption.PlaybackControl.pause:
       guard let paused = UnsafePointer<Bool>(OpaquePointer(property.data))?.pointee else {
         logPropertyValueError(MPVOption.PlaybackControl.pause, property.format)
         break
       }
-      DispatchQueue.main.async { [self] in
+      deliverPropertyChange(name) { [self] in
         if (player.info.state == .paused) != paused {
           player.sendOSD(paused ? .pause : .resume)
           player.info.state = paused ? .paused : .playing
@@ -1215,21 +1406,21 @@ class MPVController: NSObject {
       }
 
     case MPVProperty.chapter:
-      DispatchQueue.main.async { self.player.chapterChanged() }
+      deliverPropertyChange(name) { self.player.chapterChanged() }
 
     case MPVOption.PlaybackControl.speed:
       guard let data = UnsafePointer<Double>(OpaquePointer(property.data))?.pointee else {
         logPropertyValueError(MPVOption.PlaybackControl.speed, property.format)
         break
       }
-      DispatchQueue.main.async { [self] in
+      deliverPropertyChange(name) { [self] in
         player.info.playSpeed = data
         player.sendOSD(.speed(data))
         player.needReloadQuickSettingsView()
       }
 
     case MPVOption.PlaybackControl.loopPlaylist, MPVOption.PlaybackControl.loopFile:
-      DispatchQueue.main.async { [self] in
+      deliverPropertyChange(name) { [self] in
         let loopMode = player.getLoopMode()
         switch loopMode {
         case .file:
@@ -1247,7 +1438,7 @@ class MPVController: NSObject {
         logPropertyValueError(MPVOption.Video.deinterlace, property.format)
         break
       }
-      DispatchQueue.main.async { [self] in
+      deliverPropertyChange(name) { [self] in
         // this property will fire a change event at file start
         if player.info.deinterlace != data {
           player.info.deinterlace = data
@@ -1258,7 +1449,7 @@ class MPVController: NSObject {
 
     case MPVOption.Video.hwdec:
       let data = String(cString: property.data.assumingMemoryBound(to: UnsafePointer<UInt8>.self).pointee)
-      DispatchQueue.main.async { [self] in
+      deliverPropertyChange(name) { [self] in
         if player.info.hwdec != data {
           player.info.hwdec = data
           player.sendOSD(.hwdec(player.info.hwdecEnabled))
@@ -1272,14 +1463,14 @@ class MPVController: NSObject {
         break
       }
       let intData = Int(data)
-      DispatchQueue.main.async { self.player.info.rotation = intData }
+      deliverPropertyChange(name) { self.player.info.rotation = intData }
 
     case MPVOption.Audio.mute:
       guard let data = UnsafePointer<Bool>(OpaquePointer(property.data))?.pointee else {
         logPropertyValueError(MPVOption.Audio.mute, property.format)
         break
       }
-      DispatchQueue.main.async { [self] in
+      deliverPropertyChange(name) { [self] in
         player.syncUI(.volume)
         player.info.isMuted = data
         player.sendOSD(data ? OSDMessage.mute : OSDMessage.unMute)
@@ -1290,7 +1481,7 @@ class MPVController: NSObject {
         logPropertyValueError(MPVOption.Audio.volume, property.format)
         break
       }
-      DispatchQueue.main.async { [self] in
+      deliverPropertyChange(name) { [self] in
         player.info.volume = data
         player.syncUI(.volume)
         player.sendOSD(.volume(Int(data)))
@@ -1301,7 +1492,7 @@ class MPVController: NSObject {
         logPropertyValueError(MPVOption.Audio.audioDelay, property.format)
         break
       }
-      DispatchQueue.main.async { [self] in
+      deliverPropertyChange(name) { [self] in
         player.info.audioDelay = data
         player.sendOSD(.audioDelay(data))
         player.needReloadQuickSettingsView()
@@ -1309,14 +1500,14 @@ class MPVController: NSObject {
 
     case MPVOption.Subtitles.subVisibility:
       if let visible = UnsafePointer<Bool>(OpaquePointer(property.data))?.pointee {
-        DispatchQueue.main.async {
+        deliverPropertyChange(name) {
           self.player.subVisibilityChanged(visible)
         }
       }
 
     case MPVOption.Subtitles.secondarySubVisibility:
       if let visible = UnsafePointer<Bool>(OpaquePointer(property.data))?.pointee {
-        DispatchQueue.main.async {
+        deliverPropertyChange(name) {
           self.player.secondSubVisibilityChanged(visible)
         }
       }
@@ -1329,10 +1520,10 @@ class MPVController: NSObject {
         break
       }
       guard name == MPVOption.Subtitles.subDelay else {
-        DispatchQueue.main.async { self.player.secondarySubDelayChanged(data) }
+        deliverPropertyChange(name) { self.player.secondarySubDelayChanged(data) }
         break
       }
-      DispatchQueue.main.async { self.player.subDelayChanged(data) }
+      deliverPropertyChange(name) { self.player.subDelayChanged(data) }
 
     case MPVOption.Subtitles.subScale:
       guard let data = UnsafePointer<Double>(OpaquePointer(property.data))?.pointee else {
@@ -1341,7 +1532,7 @@ class MPVController: NSObject {
       }
       let displayValue = data >= 1 ? data : -1/data
       let truncated = round(displayValue * 100) / 100
-      DispatchQueue.main.async { [self] in
+      deliverPropertyChange(name) { [self] in
         player.sendOSD(.subScale(truncated))
         player.needReloadQuickSettingsView()
       }
@@ -1354,10 +1545,10 @@ class MPVController: NSObject {
         break
       }
       guard name == MPVOption.Subtitles.subPos else {
-        DispatchQueue.main.async { self.player.secondarySubPosChanged(data) }
+        deliverPropertyChange(name) { self.player.secondarySubPosChanged(data) }
         break
       }
-      DispatchQueue.main.async { self.player.subPosChanged(data) }
+      deliverPropertyChange(name) { self.player.subPosChanged(data) }
 
     case MPVOption.Equalizer.contrast:
       guard let data = UnsafePointer<Int64>(OpaquePointer(property.data))?.pointee else {
@@ -1365,7 +1556,7 @@ class MPVController: NSObject {
         break
       }
       let intData = Int(data)
-      DispatchQueue.main.async { [self] in
+      deliverPropertyChange(name) { [self] in
         player.info.contrast = intData
         player.sendOSD(.contrast(intData))
         player.needReloadQuickSettingsView()
@@ -1377,7 +1568,7 @@ class MPVController: NSObject {
         break
       }
       let intData = Int(data)
-      DispatchQueue.main.async { [self] in
+      deliverPropertyChange(name) { [self] in
         player.info.hue = intData
         player.sendOSD(.hue(intData))
         player.needReloadQuickSettingsView()
@@ -1389,7 +1580,7 @@ class MPVController: NSObject {
         break
       }
       let intData = Int(data)
-      DispatchQueue.main.async { [self] in
+      deliverPropertyChange(name) { [self] in
         player.info.brightness = intData
         player.sendOSD(.brightness(intData))
         player.needReloadQuickSettingsView()
@@ -1401,7 +1592,7 @@ class MPVController: NSObject {
         break
       }
       let intData = Int(data)
-      DispatchQueue.main.async { [self] in
+      deliverPropertyChange(name) { [self] in
         player.info.gamma = intData
         player.sendOSD(.gamma(intData))
         player.needReloadQuickSettingsView()
@@ -1413,7 +1604,7 @@ class MPVController: NSObject {
         break
       }
       let intData = Int(data)
-      DispatchQueue.main.async { [self] in
+      deliverPropertyChange(name) { [self] in
         player.info.saturation = intData
         player.sendOSD(.saturation(intData))
         player.needReloadQuickSettingsView()
@@ -1422,31 +1613,31 @@ class MPVController: NSObject {
     // following properties may change before file loaded
 
     case MPVProperty.playlistCount:
-      DispatchQueue.main.async { self.player.postNotification(.iinaPlaylistChanged) }
+      deliverPropertyChange(name) { self.player.postNotification(.iinaPlaylistChanged) }
 
     case MPVProperty.trackList:
-      DispatchQueue.main.async { self.player.trackListChanged() }
+      deliverPropertyChange(name) { self.player.trackListChanged() }
 
     case MPVProperty.vf:
-      DispatchQueue.main.async { [self] in
+      deliverPropertyChange(name) { [self] in
         player.vfChanged()
         player.needReloadQuickSettingsView()
       }
 
     case MPVProperty.af:
-      DispatchQueue.main.async { self.player.afChanged() }
+      deliverPropertyChange(name) { self.player.afChanged() }
 
     case MPVOption.Window.fullscreen:
-      DispatchQueue.main.async { self.player.fullscreenChanged() }
+      deliverPropertyChange(name) { self.player.fullscreenChanged() }
 
     case MPVOption.Window.ontop:
-      DispatchQueue.main.async { self.player.ontopChanged() }
+      deliverPropertyChange(name) { self.player.ontopChanged() }
 
     case MPVOption.Window.windowScale:
-      DispatchQueue.main.async { self.player.windowScaleChanged() }
+      deliverPropertyChange(name) { self.player.windowScaleChanged() }
 
     case MPVProperty.mediaTitle:
-      DispatchQueue.main.async { self.player.mediaTitleChanged() }
+      deliverPropertyChange(name) { self.player.mediaTitleChanged() }
 
     case MPVProperty.idleActive:
       guard let idleActive = UnsafePointer<Bool>(OpaquePointer(property.data))?.pointee else {
@@ -1454,38 +1645,127 @@ class MPVController: NSObject {
         break
       }
       guard idleActive else { break }
-      DispatchQueue.main.async { self.player.idleActiveChanged() }
+      deliverPropertyChange(name) { self.player.idleActiveChanged() }
 
     default:
       // Utility.log("MPV property changed (unhandled): \(name)")
       break
     }
 
-    // This code is running in the com.colliderli.iina.controller dispatch queue. We must not run
-    // plugins from a task in this queue. Accessing EventController data from a thread in this queue
+    // This code is running in the com.colliderli.iina.controller event thread. We must not run
+    // plugins from this thread. Accessing EventController data from this thread
     // results in data races that can cause a crash. See issue 3986.
-    DispatchQueue.main.async { [self] in
-      let eventName = EventController.Name("mpv.\(name).changed")
+    // The value is read here as the event data is freed once this method returns.
+    let data: Any
+    switch property.format {
+    case MPV_FORMAT_FLAG:
+      data = property.data.bindMemory(to: Bool.self, capacity: 1).pointee
+    case MPV_FORMAT_INT64:
+      data = property.data.bindMemory(to: Int64.self, capacity: 1).pointee
+    case MPV_FORMAT_DOUBLE:
+      data = property.data.bindMemory(to: Double.self, capacity: 1).pointee
+    case MPV_FORMAT_STRING:
+      data = String(cString: property.data.assumingMemoryBound(to: UnsafePointer<CChar>.self).pointee)
+    default:
+      data = 0
+    }
+    let eventName = EventController.Name("mpv.\(name).changed")
+    deliverPropertyChange(name, key: eventName.rawValue) { [self] in
       if player.events.hasListener(for: eventName) {
         // FIXME: better convert to JSValue before passing to call()
-        let data: Any
-        switch property.format {
-        case MPV_FORMAT_FLAG:
-          data = property.data.bindMemory(to: Bool.self, capacity: 1).pointee
-        case MPV_FORMAT_INT64:
-          data = property.data.bindMemory(to: Int64.self, capacity: 1).pointee
-        case MPV_FORMAT_DOUBLE:
-          data = property.data.bindMemory(to: Double.self, capacity: 1).pointee
-        case MPV_FORMAT_STRING:
-          data = property.data.bindMemory(to: String.self, capacity: 1).pointee
-        default:
-          data = 0
-        }
         player.events.emit(eventName, data: data)
       }
     }
   }
 
+  // MARK: - Property Change Delivery
+
+  /// Queue a property change for the main thread, replacing a change with the same key that has not been delivered yet.
+  ///
+  /// Only the latest value of a property matters to the UI, so changes that arrive faster than the main thread handles them are
+  /// dropped instead of queuing a block on the main thread for each of them. Changes of `rateLimitedProperties` are delivered at
+  /// most once per `propertyChangeInterval`, other changes are delivered right away together with any pending changes.
+  /// - Parameters:
+  ///   - name: The name of the property.
+  ///   - key: The key the change is coalesced by, the name of the property if `nil`.
+  ///   - handler: The closure to run on the main thread.
+  private func deliverPropertyChange(_ name: String, key: String? = nil, _ handler: @escaping () -> Void) {
+    let key = key ?? name
+    propertyChangeLock.withLock {
+      propertyChangeCounts.received += 1
+      if pendingPropertyChanges.updateValue(handler, forKey: key) == nil {
+        pendingPropertyChangeKeys.append(key)
+      } else {
+        propertyChangeCounts.dropped += 1
+      }
+    }
+    schedulePropertyChangeDelivery(immediately: !MPVController.rateLimitedProperties.contains(name))
+  }
+
+  /// Schedule the delivery of pending property changes to the main thread, if not already scheduled.
+  private func schedulePropertyChangeDelivery(immediately: Bool) {
+    propertyChangeLock.withLock {
+      guard !pendingPropertyChanges.isEmpty, !immediateDeliveryScheduled else { return }
+      let delay = immediately ? 0 : lastPropertyChangeDelivery + MPVController.propertyChangeInterval - CACurrentMediaTime()
+      let generation = propertyChangeGeneration
+      if delay <= 0 {
+        immediateDeliveryScheduled = true
+        DispatchQueue.main.async { self.deliverPropertyChanges(generation: generation) }
+      } else if !delayedDeliveryScheduled {
+        delayedDeliveryScheduled = true
+        DispatchQueue.main.asyncAfter(deadline: .now() + delay) { self.deliverPropertyChanges(generation: generation) }
+      }
+    }
+  }
+
+  /// Pass the pending property changes to the main thread ahead of another event.
+  ///
+  /// The changes are taken now rather than when the main thread runs the block, so changes that arrive after the event are
+  /// handled after it, in the order mpv sent them. Deliveries scheduled earlier are left with nothing to deliver.
+  private func flushPropertyChanges() {
+    let handlers = propertyChangeLock.withLock { takePendingPropertyChanges() }
+    guard !handlers.isEmpty else { return }
+    DispatchQueue.main.async {
+      for handler in handlers {
+        handler()
+      }
+    }
+  }
+
+  /// Run the handlers of the pending property changes in the order the properties first changed, unless the changes have been
+  /// taken since the delivery was scheduled. Must be called on the main thread.
+  private func deliverPropertyChanges(generation: Int) {
+    let handlers = propertyChangeLock.withLock { () -> [() -> Void] in
+      guard generation == propertyChangeGeneration else { return [] }
+      return takePendingPropertyChanges()
+    }
+    for handler in handlers {
+      handler()
+    }
+  }
+
+  /// Remove the pending property changes and return their handlers in the order the properties first changed. Must be called
+  /// while holding `propertyChangeLock`.
+  private func takePendingPropertyChanges() -> [() -> Void] {
+    propertyChangeGeneration += 1
+    immediateDeliveryScheduled = false
+    delayedDeliveryScheduled = false
+    guard !pendingPropertyChangeKeys.isEmpty else { return [] }
+    lastPropertyChangeDelivery = CACurrentMediaTime()
+    let handlers = pendingPropertyChangeKeys.compactMap { pendingPropertyChanges[$0] }
+    pendingPropertyChanges.removeAll(keepingCapacity: true)
+    pendingPropertyChangeKeys.removeAll(keepingCapacity: true)
+    propertyChangeCounts.delivered += handlers.count
+    return handlers
+  }
+
+  /// Log the number of property changes received from mpv, delivered to the main thread and dropped because a newer change of the
+  /// same property replaced them.
+  private func logPropertyChangeCounts() {
+    let counts = propertyChangeLock.withLock { propertyChangeCounts }
+    log("Property changes: \(counts.received) received, \(counts.delivered) delivered, \(counts.dropped) dropped")
+  }
+
   // MARK: - User Options
 
 
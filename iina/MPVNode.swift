@@ -200,6 +200,14 @@ class MPVNode {
     }
   }
 
+  /// Returns the maps in a parsed node array, such as the entries of the `track-list`, `playlist` and `chapter-list` properties.
+  ///
+  /// Reading a list property as one node takes a single call into mpv, instead of one call per field of every entry.
+  static func maps(_ parsed: Any?) -> [[String: Any?]] {
+    guard let array = parsed as? [Any?] else { return [] }
+    return array.compactMap { $0 as? [String: Any?] }
+  }
+
   private static func allocString(_ str: String) -> UnsafeMutablePointer<CChar> {
     let cstring = str.utf8CString
     let ptr = UnsafeMutablePointer<CChar>.allocate(capacity: cstring.count)
@@ -296,3 +304,28 @@ extension mpv_node: CustomDebugStringConvertible {
     }
   }
 }
+
+/// Typed access to the values of a parsed node map, where integers are `Int64`.
+extension Dictionary where Key == String, Value == Any? {
+
+  func int(_ key: String) -> Int? {
+    guard case let value as Int64 = self[key] ?? nil else { return nil }
+    return Int(value)
+  }
+
+  func double(_ key: String) -> Double? {
+    switch self[key] ?? nil {
+    case let value as Double: return value
+    case let value as Int64: return Double(value)
+    default: return nil
+    }
+  }
+
+  func flag(_ key: String) -> Bool {
+    (self[key] ?? nil) as? Bool ?? false
+  }
+
+  func string(_ key: String) -> String? {
+    (self[key] ?? nil) as? String
+  }
+}
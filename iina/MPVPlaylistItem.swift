@@ -10,6 +10,9 @@ import Cocoa
 
 class MPVPlaylistItem: NSObject {
 
+  /// Identifier mpv assigns to the entry, which stays the same when the entry is moved. `0` if not provided by mpv.
+  var id: Int
+
   /** Actually this is the path. Use `filename` to conform mpv API's naming. */
   var filename: String
 
@@ -24,11 +27,24 @@ class MPVPlaylistItem: NSObject {
 
   var title: String?
 
-  init(filename: String, isCurrent: Bool, isPlaying: Bool, title: String?) {
+  init(id: Int, filename: String, isCurrent: Bool, isPlaying: Bool, title: String?) {
+    self.id = id
     self.filename = filename
     self.isCurrent = isCurrent
     self.isPlaying = isPlaying
     self.title = title
     self.isNetworkResource = Regex.url.matches(filename)
   }
+
+  /// Create an item from an entry of the `playlist` property read as a node.
+  convenience init?(node: [String: Any?]) {
+    guard let filename = node.string("filename") else { return nil }
+    self.init(id: node.int("id") ?? 0, filename: filename, isCurrent: node.flag("current"), isPlaying: node.flag("playing"),
+              title: node.string("title"))
+  }
+
+  /// Whether the entry is shown the same way as the given entry in the playlist.
+  func hasSameContent(as other: MPVPlaylistItem) -> Bool {
+    filename == other.filename && isCurrent == other.isCurrent && isPlaying == other.isPlaying && title == other.title
+  }
 }
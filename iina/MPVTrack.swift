@@ -130,6 +130,26 @@ class MPVTrack: NSObject {
     self.isExternal = isExternal
   }
 
+  /// Create a track from an entry of the `track-list` property read as a node, `nil` if the entry has no known type.
+  convenience init?(node: [String: Any?]) {
+    guard let type = node.string("type").flatMap(TrackType.init(rawValue:)), let id = node.int("id") else { return nil }
+    self.init(id: id, type: type, isDefault: node.flag("default"), isForced: node.flag("forced"),
+              isSelected: node.flag("selected"), isExternal: node.flag("external"))
+    srcId = node.int("src-id")
+    title = node.string("title")
+    lang = node.string("lang")
+    codec = node.string("codec")
+    externalFilename = node.string("external-filename")
+    isAlbumart = node.flag("albumart")
+    decoderDesc = node.string("decoder-desc")
+    demuxW = node.int("demux-w")
+    demuxH = node.int("demux-h")
+    demuxFps = node.double("demux-fps")
+    demuxChannelCount = node.int("demux-channel-count")
+    demuxChannels = node.string("demux-channels")
+    demuxSamplerate = node.int("demux-samplerate")
+  }
+
   // Utils
 
   var isImageSub: Bool {
@@ -1064,7 +1064,7 @@ class MainWindowController: PlayerWindowController {
       isMouseInSlider = true
       if !controlBarFloating.isDragging {
         timePreviewWhenSeek.isHidden = false
-        thumbnailPeekView.isHidden = !player.info.thumbnailsReady
+        thumbnailPeekView.isHidden = !player.info.thumbnailsReady && !player.info.canShowPartialThumbnails
       }
       refreshSeekTimeAndThumbnail(from: event)
     }
@@ -1089,6 +1089,7 @@ class MainWindowController: PlayerWindowController {
       timePreviewWhenSeek.isHidden = true
       refreshSeekTimeAndThumbnail(from: event)
       thumbnailPeekView.isHidden = true
+      player.cancelThumbnailRefinement()
     }
   }
 
@@ -1555,6 +1556,8 @@ class MainWindowController: PlayerWindowController {
       cropSettingsView?.cropBoxView.resized(with: videoView.frame)
     }
 
+    player.ffmpegController.thumbnailSeekBarWidth = Int(playSlider.frame.width)
+
     // update control bar position
     if oscPosition == .floating {
       let cph = Preference.float(for: .controlBarPositionHorizontal)
@@ -2278,6 +2281,7 @@ class MainWindowController: PlayerWindowController {
       updateTimeLabel(event.locationInWindow)
     } else {
       thumbnailPeekView.isHidden = true
+      player.cancelThumbnailRefinement()
     }
   }
 
@@ -2322,9 +2326,10 @@ class MainWindowController: PlayerWindowController {
       let previewTime = duration * percentage
       timePreviewWhenSeek.stringValue = previewTime.stringRepresentation
 
-      if player.info.thumbnailsReady, let image = player.info.getThumbnail(forSecond: previewTime.second)?.image {
+      if player.info.thumbnailsReady || player.info.canShowPartialThumbnails, let image = player.info.getThumbnail(forSecond: previewTime.second)?.image {
         thumbnailPeekView.imageView.image = image.rotate(rotation)
         thumbnailPeekView.isHidden = false
+        player.refineThumbnails(aroundSecond: previewTime.second)
 
         // In some formats (like most of Japanese TV video formats), display aspect ratios (DAR) are different from the
         // sample aspect ratio (SAR). A typical configuration is SAR 1440x1080i (4:3) w/ DAR 1920x1080 (16:9). Here we try
@@ -0,0 +1,271 @@
+//
+//  MediaInfoCache.swift
+//  iina
+//
+//  Created by agent on 10/16/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+fileprivate let subsystem = Logger.makeSubsystem("mediainfo")
+
+/// A persistent cache of the information `FFmpegController.probeVideoInfo(forFile:)` returns, so the files in a playlist are
+/// not probed again every time IINA is launched.
+///
+/// Like the thumbnail cache an entry is only used while the size and modification time of its file are unchanged. The cache
+/// file is an append only log of records, all values in native byte order:
+/// ```
+/// [version]
+/// [record length][path][file size][modification time][duration][title][album][artist][streams][codec] × records
+/// ```
+/// Strings are stored as `[length][UTF-8 bytes]`, a length of `StringLength.max` stands for a missing string. The file is read
+/// once when the cache is first used. New entries are collected and appended together, and the file is rewritten when most of
+/// its records have been replaced by newer ones.
+final class MediaInfoCache {
+
+  static let shared = MediaInfoCache()
+
+  private typealias CacheVersion = UInt8
+  private typealias RecordLength = UInt32
+  private typealias StringLength = UInt16
+  private typealias FileSize = UInt64
+  private typealias FileTimestamp = Int64
+
+  private static let version: CacheVersion = 1
+
+  /// Time new entries are held back waiting for more entries to append along with them.
+  private static let writeDelay: TimeInterval = 1
+  /// Number of new entries that are appended without waiting for `writeDelay`.
+  private static let writeLimit = 500
+  /// Minimum number of records before the file is rewritten to drop outdated records.
+  private static let compactionThreshold = 1000
+
+  /// Keys of the information dictionary, other than the duration, that are cached, in the order they are stored.
+  private static let stringKeys = ["title", "album", "artist", "@iina_streams", "@iina_codec"]
+  private static let durationKey = "@iina_duration"
+
+  private struct Entry {
+    var fileSize: FileSize
+    var fileTimestamp: FileTimestamp
+    var duration: Double
+    var strings: [String?]
+  }
+
+  private let url = Utility.cacheURL.appendingPathComponent(AppData.mediaInfoCacheFile, isDirectory: false)
+  private let queue = DispatchQueue(label: "IINAMediaInfoCache", qos: .utility)
+
+  // The following state is protected by `lock`.
+  private let lock = Lock()
+  private var entries: [String: Entry] = [:]
+  private var loaded = false
+  private var recordCount = 0
+  private var pendingRecords = Data()
+  private var pendingCount = 0
+  private var writeScheduled = false
+
+  private func log(_ message: String, level: Logger.Level = .debug) {
+    Logger.log(message, level: level, subsystem: subsystem)
+  }
+
+  /// Return the cached information for the given file, or `nil` if the file is not cached or has changed since.
+  func info(forFile path: String) -> [AnyHashable: Any]? {
+    guard let (fileSize, fileTimestamp) = fileMetadata(path) else { return nil }
+    guard let entry = lock.withLock({ () -> Entry? in
+      loadIfNeeded()
+      return entries[path]
+    }), entry.fileSize == fileSize, entry.fileTimestamp == fileTimestamp else { return nil }
+    var info: [AnyHashable: Any] = [MediaInfoCache.durationKey: entry.duration]
+    for (key, value) in zip(MediaInfoCache.stringKeys, entry.strings) where value != nil {
+      info[key] = value
+    }
+    return info
+  }
+
+  /// Add the information obtained for the given file to the cache.
+  func store(_ info: [AnyHashable: Any], forFile path: String) {
+    guard let (fileSize, fileTimestamp) = fileMetadata(path) else { return }
+    // Metadata tags are matched without regard to case, like `PlayerCore` does
+    var tags: [String: String] = [:]
+    for (key, value) in info {
+      guard let key = key as? String, let value = value as? String else { continue }
+      tags[key.lowercased()] = value
+    }
+    let duration = (info[MediaInfoCache.durationKey] as? Double) ?? -1
+    let entry = Entry(fileSize: fileSize, fileTimestamp: fileTimestamp, duration: duration,
+                      strings: MediaInfoCache.stringKeys.map { tags[$0] })
+    let record = MediaInfoCache.encode(entry, forFile: path)
+    lock.withLock {
+      loadIfNeeded()
+      entries[path] = entry
+      pendingRecords.append(record)
+      pendingCount += 1
+      if pendingCount >= MediaInfoCache.writeLimit {
+        queue.async { self.flush() }
+      } else if !writeScheduled {
+        writeScheduled = true
+        queue.asyncAfter(deadline: .now() + MediaInfoCache.writeDelay) { self.flush() }
+      }
+    }
+  }
+
+  /// Append the entries that have not been written yet to the cache file. Called when IINA terminates.
+  func synchronize() {
+    queue.sync { flush() }
+  }
+
+  /// Remove all entries and the cache file.
+  func clear() {
+    queue.sync {
+      lock.withLock {
+        entries.removeAll()
+        pendingRecords.removeAll()
+        pendingCount = 0
+        recordCount = 0
+        loaded = true
+      }
+      try? FileManager.default.removeItem(at: url)
+    }
+  }
+
+  // MARK: - Private
+
+  /// Must be called on `queue`.
+  private func flush() {
+    let (records, count) = lock.withLock { () -> (Data, Int) in
+      let pending = (pendingRecords, pendingCount)
+      pendingRecords.removeAll()
+      pendingCount = 0
+      writeScheduled = false
+      recordCount += pending.1
+      return pending
+    }
+    guard count > 0 else { return }
+    if !FileManager.default.fileExists(atPath: url.path) {
+      guard FileManager.default.createFile(atPath: url.path, contents: Data(bytesOf: MediaInfoCache.version)) else {
+        log("Cannot create media info cache file.", level: .error)
+        return
+      }
+    }
+    guard let file = try? FileHandle(forUpdating: url) else {
+      log("Cannot write to media info cache file.", level: .error)
+      return
+    }
+    defer { file.closeFile() }
+    file.seekToEndOfFile()
+    file.write(records)
+    log("Appended \(count) entries to the media info cache")
+  }
+
+  /// Read the cache file. Must be called while holding `lock`.
+  private func loadIfNeeded() {
+    guard !loaded else { return }
+    loaded = true
+    guard FileManager.default.fileExists(atPath: url.path) else { return }
+    let startTime = CACurrentMediaTime()
+    guard let data = try? Data(contentsOf: url, options: .alwaysMapped),
+          data.read(type: CacheVersion.self, at: 0) == MediaInfoCache.version else {
+      log("Media info cache is outdated or corrupt. Cache file will be deleted.", level: .warning)
+      try? FileManager.default.removeItem(at: url)
+      return
+    }
+    var offset = MemoryLayout<CacheVersion>.size
+    // A record cut short by an interruption ends the file
+    while let length = data.read(type: RecordLength.self, at: offset),
+          offset + MemoryLayout<RecordLength>.size + Int(length) <= data.count {
+      let start = offset + MemoryLayout<RecordLength>.size
+      offset = start + Int(length)
+      guard let (path, entry) = MediaInfoCache.decode(data, in: start..<offset) else { continue }
+      entries[path] = entry
+      recordCount += 1
+    }
+    if offset < data.count {
+      // Drop the partial record so records appended later can be read
+      let end = UInt64(offset)
+      queue.async {
+        guard let file = try? FileHandle(forUpdating: self.url) else { return }
+        file.truncateFile(atOffset: end)
+        file.closeFile()
+      }
+    }
+    log("Read \(entries.count) entries from the media info cache, took \(String(format: "%.2f", (CACurrentMediaTime() - startTime) * 1000))ms")
+
+    if recordCount > MediaInfoCache.compactionThreshold && recordCount > 2 * entries.count {
+      let snapshot = entries
+      recordCount = snapshot.count
+      queue.async { self.rewrite(snapshot) }
+    }
+  }
+
+  /// Replace the cache file with one holding only the given entries. Must be called on `queue`.
+  private func rewrite(_ snapshot: [String: Entry]) {
+    var data = Data(bytesOf: MediaInfoCache.version)
+    for (path, entry) in snapshot {
+      data.append(MediaInfoCache.encode(entry, forFile: path))
+    }
+    do {
+      try data.write(to: url, options: .atomic)
+      log("Compacted the media info cache to \(snapshot.count) entries")
+    } catch {
+      log("Cannot write to media info cache file: \(error)", level: .error)
+    }
+  }
+
+  /// Return the size and modification time of the given file. Uses `stat` directly as this is called for every file in the
+  /// playlist.
+  private func fileMetadata(_ path: String) -> (FileSize, FileTimestamp)? {
+    var info = stat()
+    guard stat(path, &info) == 0 else { return nil }
+    return (FileSize(info.st_size), FileTimestamp(info.st_mtimespec.tv_sec))
+  }
+
+  private static func encode(_ entry: Entry, forFile path: String) -> Data {
+    var record = Data()
+    appendString(path, to: &record)
+    record.append(Data(bytesOf: entry.fileSize))
+    record.append(Data(bytesOf: entry.fileTimestamp))
+    record.append(Data(bytesOf: entry.duration))
+    for string in entry.strings {
+      appendString(string, to: &record)
+    }
+    var data = Data(bytesOf: RecordLength(record.count))
+    data.append(record)
+    return data
+  }
+
+  private static func appendString(_ string: String?, to data: inout Data) {
+    guard let string = string else {
+      data.append(Data(bytesOf: StringLength.max))
+      return
+    }
+    // Tags longer than the length field allows are truncated, they are only shown in the playlist
+    let bytes = Data(string.utf8.prefix(Int(StringLength.max - 1)))
+    data.append(Data(bytesOf: StringLength(bytes.count)))
+    data.append(bytes)
+  }
+
+  private static func decode(_ data: Data, in range: Range<Int>) -> (String, Entry)? {
+    var offset = range.lowerBound
+    func readString() -> String?? {
+      guard let length = data.read(type: StringLength.self, at: offset) else { return nil }
+      offset += MemoryLayout<StringLength>.size
+      if length == StringLength.max { return .some(nil) }
+      guard offset + Int(length) <= range.upperBound else { return nil }
+      defer { offset += Int(length) }
+      return String(decoding: data.subdata(in: offset..<offset + Int(length)), as: UTF8.self)
+    }
+    guard let path = readString() ?? nil,
+          let fileSize = data.read(type: FileSize.self, at: offset),
+          let fileTimestamp = data.read(type: FileTimestamp.self, at: offset + MemoryLayout<FileSize>.size),
+          let duration = data.read(type: Double.self, at: offset + MemoryLayout<FileSize>.size + MemoryLayout<FileTimestamp>.size)
+    else { return nil }
+    offset += MemoryLayout<FileSize>.size + MemoryLayout<FileTimestamp>.size + MemoryLayout<Double>.size
+    var strings: [String?] = []
+    for _ in stringKeys {
+      guard let string = readString() else { return nil }
+      strings.append(string)
+    }
+    guard offset <= range.upperBound else { return nil }
+    return (path, Entry(fileSize: fileSize, fileTimestamp: fileTimestamp, duration: duration, strings: strings))
+  }
+}
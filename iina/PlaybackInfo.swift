@@ -327,19 +327,44 @@ class PlaybackInfo {
 
   @Atomic var thumbnailsReady = false
   @Atomic var thumbnailsProgress: Double = 0
-  @Atomic var thumbnails: [FFThumbnail] = []
 
-  func getThumbnail(forSecond sec: Double) -> FFThumbnail? {
-    $thumbnails.withLock {
-      guard !$0.isEmpty else { return nil }
-      var tb = $0.last!
-      for i in 0..<$0.count {
-        if $0[i].realTime >= sec {
-          tb = $0[(i == 0 ? i : i - 1)]
-          break
-        }
+  /// The thumbnails of the current video.
+  ///
+  /// The index is replaced, never modified, so readers only hold the lock long enough to copy a reference.
+  @Atomic private(set) var thumbnailIndex = ThumbnailIndex()
+
+  var thumbnails: [FFThumbnail] {
+    get { thumbnailIndex.thumbnails }
+    set { thumbnailIndex = ThumbnailIndex(newValue) }
+  }
+
+  /// Add the given thumbnails to the thumbnails of the current video.
+  ///
+  /// The new index is built without holding the lock. If the index was replaced in the meantime the update is retried
+  /// against the new index, so readers never wait for the index to be built.
+  func appendThumbnails(_ newThumbnails: [FFThumbnail]) {
+    while true {
+      let current = thumbnailIndex
+      let updated = current.appending(newThumbnails)
+      let replaced: Bool = $thumbnailIndex.withLock {
+        guard $0 === current else { return false }
+        $0 = updated
+        return true
       }
-      return tb
+      if replaced { return }
     }
   }
+
+  /// Whether thumbnails can be shown while they are still being generated.
+  ///
+  /// This is the case when they are generated in progressive order, as partial results then cover the whole timeline.
+  var canShowPartialThumbnails: Bool {
+    player.ffmpegController.thumbnailProgressiveOrder && !thumbnailIndex.isEmpty
+  }
+
+  func getThumbnail(forSecond sec: Double) -> FFThumbnail? {
+    let index = thumbnailIndex
+    // Partial results may not include a thumbnail preceding the given time, use the closest one.
+    return thumbnailsReady ? index.thumbnail(forSecond: sec) : index.nearestThumbnail(forSecond: sec)
+  }
 }
@@ -164,6 +164,15 @@ class PlayerCore: NSObject {
     return controller
   }()
 
+  /// Probes the files in the playlist for their duration and metadata, see `cacheVideoInfo(_:)`.
+  lazy var videoInfoProber: VideoInfoProber = {
+    let prober = VideoInfoProber(label: "IINAVideoInfoProber\(playerNumber)")
+    prober.batchHandler = { [weak self] results in
+      self?.cacheVideoInfo(results)
+    }
+    return prober
+  }()
+
   lazy var info: PlaybackInfo = PlaybackInfo(self)
 
   var syncUITimer: Timer?
@@ -185,6 +194,10 @@ class PlayerCore: NSObject {
   var triedUsingExactSeekForCurrentFile: Bool = false
   var useExactSeekForCurrentFile: Bool = true
 
+  // thumbnail refinement, only accessed on the main thread
+  private var refinedThumbnailIntervals = Set<Double>()
+  private var scrubbedThumbnailInterval: (start: Double, refinement: DispatchWorkItem)?
+
   var isPlaylistVisible: Bool {
     isInMiniPlayer ? miniPlayer.isPlaylistVisible : mainWindow.sideBarStatus == .playlist
   }
@@ -1317,6 +1330,19 @@ class PlayerCore: NSObject {
     postNotification(.iinaPlaylistChanged)
   }
 
+  /// Add the given files to the playlist, inserted before the entry at the given index or appended if `index` is `nil`.
+  ///
+  /// Unlike calling `addToPlaylist(_:silent:)` for every file this does not wait for mpv after each file, and does not post
+  /// `iinaPlaylistChanged`.
+  /// - Returns: The number of files that could not be added.
+  func addToPlaylist(batch paths: [String], insertingAt index: Int?) -> Int {
+    let argsList: [[String?]] = paths.enumerated().map { offset, path in
+      guard let index else { return [path, "append"] }
+      return [path, "insert-at", "\(index + offset)"]
+    }
+    return mpv.loadFiles(argsList)
+  }
+
   func addToPlaylist(paths: [String], at index: Int = -1) {
     getPlaylist()
     for path in paths {
@@ -1964,6 +1990,8 @@ class PlayerCore: NSObject {
     if info.state != .loading {
       log("Playback has stopped")
       info.state = .idle
+      // The playlist is gone, drop the files waiting to be probed
+      videoInfoProber.cancelAll()
       postNotification(.iinaPlayerStopped)
     }
   }
@@ -2391,41 +2419,125 @@ class PlayerCore: NSObject {
   func generateThumbnails() {
     log("Getting thumbnails")
     info.thumbnailsReady = false
-    info.$thumbnails.withLock { $0.removeAll(keepingCapacity: true) }
+    info.thumbnails = []
     info.thumbnailsProgress = 0
     DispatchQueue.main.async {
       self.touchBarSupport.touchBarPlaySlider?.resetCachedThumbnails()
+      self.refinedThumbnailIntervals.removeAll()
+      self.cancelThumbnailRefinement()
     }
-    guard !info.isNetworkResource, let url = info.currentURL else {
+    guard let url = info.currentURL else {
       log("...stopped because cannot get file path", level: .warning)
       return
     }
-    if !Preference.bool(for: .enableThumbnailForRemoteFiles) {
-      if let attrs = try? url.resourceValues(forKeys: Set([.volumeIsLocalKey])), !attrs.volumeIsLocal! {
-        log("...stopped because file is on a mounted remote drive", level: .warning)
-        return
-      }
+    // Network streams and files on mounted remote drives are read in network mode, which keeps the reads bounded
+    let isRemote = info.isNetworkResource ||
+      (try? url.resourceValues(forKeys: Set([.volumeIsLocalKey])))?.volumeIsLocal == false
+    if isRemote && !Preference.bool(for: .enableThumbnailForRemoteFiles) {
+      log("...stopped because file is a network resource or on a mounted remote drive", level: .warning)
+      return
     }
+    ffmpegController.thumbnailNetworkMode = isRemote
+    ffmpegController.thumbnailNetworkConnectionCount = Preference.integer(for: .thumbnailNetworkConnectionCount)
+    ffmpegController.thumbnailNetworkByteRate = Preference.integer(for: .thumbnailNetworkByteRate)
     if Preference.bool(for: .enableThumbnailPreview) {
-      if let cacheName = info.mpvMd5, ThumbnailCache.fileIsCached(forName: cacheName, forVideo: info.currentURL) {
+      // The cache is validated with the size and modification time of the file, thumbnails of streams are not cached
+      if url.isFileURL, let cacheName = info.mpvMd5, ThumbnailCache.fileIsCached(forName: cacheName, forVideo: url) {
         log("Found thumbnail cache")
+        readThumbnailCache(forName: cacheName)
+      } else if url.isFileURL && Preference.bool(for: .thumbnailCacheByContent) {
+        // The contents are hashed in the background, the file may have been moved, renamed or copied
         thumbnailQueue.async {
-          if let thumbnails = ThumbnailCache.read(forName: cacheName) {
-            self.info.thumbnails = thumbnails
-            self.info.thumbnailsReady = true
-            self.info.thumbnailsProgress = 1
-            self.refreshTouchBarSlider()
+          guard self.info.currentURL == url else { return }
+          if let cacheName = ThumbnailCache.nameForContent(ofVideo: url) {
+            self.log("Found thumbnail cache of a file with the same contents")
+            self.readThumbnailCache(forName: cacheName)
           } else {
-            self.log("Cannot read thumbnail from cache", level: .error)
+            self.requestThumbnails(forVideo: url)
           }
         }
       } else {
-        log("Request new thumbnails")
-        ffmpegController.generateThumbnail(forFile: url.path, thumbWidth:Int32(Preference.integer(for: .thumbnailWidth)))
+        requestThumbnails(forVideo: url)
       }
     }
   }
 
+  private func readThumbnailCache(forName cacheName: String) {
+    thumbnailQueue.async {
+      if let thumbnails = ThumbnailCache.read(forName: cacheName) {
+        self.info.thumbnails = thumbnails
+        self.info.thumbnailsReady = true
+        self.info.thumbnailsProgress = 1
+        self.refreshTouchBarSlider()
+      } else {
+        self.log("Cannot read thumbnail from cache", level: .error)
+      }
+    }
+  }
+
+  private func requestThumbnails(forVideo url: URL) {
+    log("Request new thumbnails")
+    ffmpegController.thumbnailWorkerCount = Preference.integer(for: .thumbnailWorkerCount)
+    ffmpegController.thumbnailKeyframesOnly = Preference.bool(for: .thumbnailKeyframesOnly)
+    ffmpegController.thumbnailFastDecoding = Preference.bool(for: .thumbnailFastDecoding)
+    ffmpegController.thumbnailDecoderThreadCount = Preference.integer(for: .thumbnailDecoderThreadCount)
+    ffmpegController.thumbnailFrameThreading = Preference.bool(for: .thumbnailFrameThreading)
+    ffmpegController.thumbnailProgressiveOrder = Preference.bool(for: .thumbnailProgressiveOrder)
+    ffmpegController.thumbnailAdaptiveDensity = Preference.bool(for: .thumbnailAdaptiveDensity)
+    ffmpegController.thumbnailSceneAware = Preference.bool(for: .thumbnailSceneAwareSampling)
+    // Pick up where an earlier job for the same file stopped
+    let resumeState = url.isFileURL ? info.mpvMd5.flatMap { ThumbnailCache.readPartial(forName: $0, forVideo: url) } : nil
+    ffmpegController.generateThumbnail(forFile: thumbnailFilename(for: url), thumbWidth: Int32(Preference.integer(for: .thumbnailWidth)),
+                                       resumeState: resumeState)
+  }
+
+  /// Returns the name `FFmpegController` is given for the file or stream at the given URL.
+  private func thumbnailFilename(for url: URL) -> String {
+    url.isFileURL ? url.path : url.absoluteString
+  }
+
+  /// Returns the URL of the file `FFmpegController` was given the name of, or `nil` if the name is that of a stream.
+  private func thumbnailFileURL(forFilename filename: String) -> URL? {
+    filename.hasPrefix("/") ? URL(fileURLWithPath: filename) : nil
+  }
+
+  /// Generate additional thumbnails around the given time if the user stops there while scrubbing.
+  ///
+  /// Thumbnails are spread evenly over the video at first. Where the user lingers on the seek bar thumbnails are added between the
+  /// two surrounding ones, so the preview follows the mouse more closely in the parts of the video the user is looking for. The
+  /// refinement starts once the mouse has stayed between the same two thumbnails for `AppData.thumbnailRefinementDelay`, whether
+  /// or not it moves in the meantime.
+  /// - Important: Must be called on the main thread.
+  func refineThumbnails(aroundSecond sec: Double) {
+    guard info.thumbnailsReady, Preference.bool(for: .enableThumbnailPreview), let url = info.currentURL,
+          let (before, after) = info.thumbnailIndex.surroundingThumbnails(forSecond: sec),
+          // Not worth it unless the added thumbnails end up at least a second apart.
+          after.realTime - before.realTime > Double(ffmpegController.thumbnailRefinementCount),
+          !refinedThumbnailIntervals.contains(before.realTime) else {
+      cancelThumbnailRefinement()
+      return
+    }
+    if let scrubbed = scrubbedThumbnailInterval, scrubbed.start == before.realTime { return }
+    cancelThumbnailRefinement()
+    let refinement = DispatchWorkItem { [self] in
+      scrubbedThumbnailInterval = nil
+      guard info.currentURL == url else { return }
+      refinedThumbnailIntervals.insert(before.realTime)
+      log("Refining thumbnails between \(before.realTime)s and \(after.realTime)s")
+      ffmpegController.refineThumbnails(forFile: thumbnailFilename(for: url), thumbWidth: Int32(Preference.integer(for: .thumbnailWidth)),
+                                        fromTime: before.realTime, toTime: after.realTime)
+    }
+    scrubbedThumbnailInterval = (before.realTime, refinement)
+    DispatchQueue.main.asyncAfter(deadline: .now() + AppData.thumbnailRefinementDelay, execute: refinement)
+  }
+
+  /// Stop waiting to refine the thumbnails the mouse was between, as it has left them or the seek bar.
+  /// - Important: Must be called on the main thread.
+  func cancelThumbnailRefinement() {
+    scrubbedThumbnailInterval?.refinement.cancel()
+    scrubbedThumbnailInterval = nil
+  }
+
   func makeTouchBar() -> NSTouchBar {
     log("Activating Touch Bar")
     needsTouchBar = true
@@ -2445,34 +2557,13 @@ class PlayerCore: NSObject {
   // MARK: - Getting info
 
   func getTrackInfo() {
+    let startTime = CACurrentMediaTime()
+    let tracks = MPVNode.maps(mpv.getNode(MPVProperty.trackList)).compactMap(MPVTrack.init(node:))
     info.audioTracks.removeAll(keepingCapacity: true)
     info.videoTracks.removeAll(keepingCapacity: true)
     info.$subTracks.withLock {
       $0.removeAll(keepingCapacity: true)
-      let trackCount = mpv.getInt(MPVProperty.trackListCount)
-      for index in 0..<trackCount {
-        // get info for each track
-        guard let trackType = mpv.getString(MPVProperty.trackListNType(index)) else { continue }
-        let track = MPVTrack(id: mpv.getInt(MPVProperty.trackListNId(index)),
-                             type: MPVTrack.TrackType(rawValue: trackType)!,
-                             isDefault: mpv.getFlag(MPVProperty.trackListNDefault(index)),
-                             isForced: mpv.getFlag(MPVProperty.trackListNForced(index)),
-                             isSelected: mpv.getFlag(MPVProperty.trackListNSelected(index)),
-                             isExternal: mpv.getFlag(MPVProperty.trackListNExternal(index)))
-        track.srcId = mpv.getInt(MPVProperty.trackListNSrcId(index))
-        track.title = mpv.getString(MPVProperty.trackListNTitle(index))
-        track.lang = mpv.getString(MPVProperty.trackListNLang(index))
-        track.codec = mpv.getString(MPVProperty.trackListNCodec(index))
-        track.externalFilename = mpv.getString(MPVProperty.trackListNExternalFilename(index))
-        track.isAlbumart = mpv.getString(MPVProperty.trackListNAlbumart(index)) == "yes"
-        track.decoderDesc = mpv.getString(MPVProperty.trackListNDecoderDesc(index))
-        track.demuxW = mpv.getInt(MPVProperty.trackListNDemuxW(index))
-        track.demuxH = mpv.getInt(MPVProperty.trackListNDemuxH(index))
-        track.demuxFps = mpv.getDouble(MPVProperty.trackListNDemuxFps(index))
-        track.demuxChannelCount = mpv.getInt(MPVProperty.trackListNDemuxChannelCount(index))
-        track.demuxChannels = mpv.getString(MPVProperty.trackListNDemuxChannels(index))
-        track.demuxSamplerate = mpv.getInt(MPVProperty.trackListNDemuxSamplerate(index))
-
+      for track in tracks {
         // add to lists
         switch track.type {
         case .audio:
@@ -2486,6 +2577,7 @@ class PlayerCore: NSObject {
         }
       }
     }
+    log("Read \(tracks.count) tracks, took \(String(format: "%.2f", (CACurrentMediaTime() - startTime) * 1000))ms", level: .verbose)
   }
 
   func getSelectedTracks() {
@@ -2496,32 +2588,22 @@ class PlayerCore: NSObject {
   }
 
   func getPlaylist() {
+    let startTime = CACurrentMediaTime()
+    let items = MPVNode.maps(mpv.getNode(MPVProperty.playlist)).compactMap(MPVPlaylistItem.init(node:))
     info.$playlist.withLock { playlist in
-      playlist.removeAll()
-      let playlistCount = mpv.getInt(MPVProperty.playlistCount)
-      for index in 0..<playlistCount {
-        let playlistItem = MPVPlaylistItem(filename: mpv.getString(MPVProperty.playlistNFilename(index))!,
-                                           isCurrent: mpv.getFlag(MPVProperty.playlistNCurrent(index)),
-                                           isPlaying: mpv.getFlag(MPVProperty.playlistNPlaying(index)),
-                                           title: mpv.getString(MPVProperty.playlistNTitle(index)))
-        playlist.append(playlistItem)
-      }
+      playlist = items
     }
+    log("Read \(items.count) playlist items, took \(String(format: "%.2f", (CACurrentMediaTime() - startTime) * 1000))ms", level: .verbose)
   }
 
   func getChapters() {
     log("Reloading chapter list", level: .verbose)
-    var chapters: [MPVChapter] = []
-    let chapterCount = mpv.getInt(MPVProperty.chapterListCount)
-    for index in 0..<chapterCount {
-      let chapter = MPVChapter(title:     mpv.getString(MPVProperty.chapterListNTitle(index)),
-                               startTime: mpv.getDouble(MPVProperty.chapterListNTime(index)),
-                               index:     index)
-      chapters.append(chapter)
-    }
+    let startTime = CACurrentMediaTime()
+    let chapters = MPVNode.maps(mpv.getNode(MPVProperty.chapterList)).enumerated().map { MPVChapter(node: $1, index: $0) }
     // Instead of modifying existing list, overwrite reference to prev list.
     // This will avoid concurrent modification crashes
     info.chapters = chapters
+    log("Read \(chapters.count) chapters, took \(String(format: "%.2f", (CACurrentMediaTime() - startTime) * 1000))ms", level: .verbose)
 
     syncUI(.chapterList)
   }
@@ -2641,12 +2723,26 @@ class PlayerCore: NSObject {
     }
   }
 
+  /// Save the results of `videoInfoProber` to info and tell the playlist which files have been probed.
+  private func cacheVideoInfo(_ results: [VideoInfoProber.Result]) {
+    var paths: [String] = []
+    for result in results {
+      guard let dict = result.info else { continue }
+      cacheVideoInfo(dict, forVideoPath: result.path)
+      paths.append(result.path)
+    }
+    guard !paths.isEmpty else { return }
+    DispatchQueue.main.async {
+      NotificationCenter.default.post(Notification(name: .iinaPlaylistVideoInfoProbed, object: self,
+                                                   userInfo: ["paths": paths]))
+    }
+  }
+
   /**
-   Get video duration, playback progress, and metadata, then save it to info.
-   It may take some time to run this method, so it should be used in background.
+   Save the video duration and metadata obtained by `FFmpegController.probeVideoInfo(forFile:)` and the playback progress
+   to info.
    */
-  func refreshCachedVideoInfo(forVideoPath path: String) {
-    guard let dict = FFmpegController.probeVideoInfo(forFile: path) else { return }
+  private func cacheVideoInfo(_ dict: [AnyHashable: Any], forVideoPath path: String) {
     let progress = Utility.playbackProgressFromWatchLater(path.md5)
     self.info.setCachedVideoDurationAndProgress(path, (
       duration: dict["@iina_duration"] as? Double,
@@ -2717,27 +2813,65 @@ class PlayerCore: NSObject {
 
 extension PlayerCore: FFmpegControllerDelegate {
 
-  func didUpdate(_ thumbnails: [FFThumbnail]?, forFile filename: String, withProgress progress: Int) {
-    guard let currentFilePath = info.currentURL?.path, currentFilePath == filename else { return }
+  func didUpdate(_ thumbnails: [FFThumbnail]?, forFile filename: String, withProgress progress: Int, thumbnailCount: Int) {
+    guard let currentURL = info.currentURL, thumbnailFilename(for: currentURL) == filename else { return }
     log("Got new thumbnails, progress \(progress)")
     if let thumbnails = thumbnails {
-      info.$thumbnails.withLock { $0.append(contentsOf: thumbnails) }
+      info.appendThumbnails(thumbnails)
+    }
+    info.thumbnailsProgress = Double(progress) / Double(thumbnailCount)
+    refreshTouchBarSlider()
+  }
+
+  func didProcessThumbnailPoints(_ points: IndexSet, thumbnails: [NSNumber: FFThumbnail], thumbnailCount: Int,
+                                 forFile filename: String) {
+    // Saved even if the file is no longer the current one, so the work done is not lost when the file was closed. The number of
+    // intervals comes with the points, by now the controller may already be set up for another file.
+    guard let fileURL = thumbnailFileURL(forFilename: filename) else { return }
+    let cacheName = Utility.mpvWatchLaterMd5(fileURL.path)
+    let thumbnails = Dictionary(uniqueKeysWithValues: thumbnails.map { ($0.key.intValue, $0.value) })
+    thumbnailQueue.async {
+      ThumbnailCache.appendPartial(points: points, thumbnails: thumbnails, thumbnailCount: thumbnailCount,
+                                   forName: cacheName, forVideo: fileURL)
     }
-    info.thumbnailsProgress = Double(progress) / Double(ffmpegController.thumbnailCount)
+  }
+
+  func didRefine(_ thumbnails: [FFThumbnail], forFile filename: String) {
+    guard let currentURL = info.currentURL, thumbnailFilename(for: currentURL) == filename else { return }
+    // A refinement may find the frames of the thumbnails it was placed between again.
+    let index = info.thumbnailIndex
+    let thumbnails = thumbnails.filter { index.nearestThumbnail(forSecond: $0.realTime)?.realTime != $0.realTime }
+    log("Got \(thumbnails.count) refined thumbnails")
+    guard !thumbnails.isEmpty else { return }
+    info.appendThumbnails(thumbnails)
     refreshTouchBarSlider()
+    if currentURL.isFileURL, let cacheName = info.mpvMd5 {
+      // The cache holds any number of thumbnails. It is saved on the same queue once the job completes, so it exists by now.
+      thumbnailQueue.async {
+        ThumbnailCache.append(thumbnails, forName: cacheName, forVideo: currentURL)
+      }
+    }
   }
 
   func didGenerate(_ thumbnails: [FFThumbnail], forFile filename: String, succeeded: Bool) {
-    guard let currentFilePath = info.currentURL?.path, currentFilePath == filename else { return }
+    guard let currentURL = info.currentURL, thumbnailFilename(for: currentURL) == filename else { return }
     log("Got all thumbnails, succeeded=\(succeeded)")
     if succeeded {
       info.thumbnails = thumbnails
       info.thumbnailsReady = true
       info.thumbnailsProgress = 1
       refreshTouchBarSlider()
-      if let cacheName = info.mpvMd5 {
-        backgroundQueue.async {
-          ThumbnailCache.write(self.info.thumbnails, forName: cacheName, forVideo: self.info.currentURL)
+      if currentURL.isFileURL, let cacheName = info.mpvMd5 {
+        // The thumbnail queue also saves the partial results, so they are all saved by now. The file may have been closed or
+        // another one opened by the time the queue gets to it, so the cache is validated against the file checked above.
+        thumbnailQueue.async {
+          if !ThumbnailCache.completePartial(forName: cacheName, forVideo: currentURL) {
+            ThumbnailCache.write(thumbnails, forName: cacheName, forVideo: currentURL)
+            ThumbnailCache.deletePartial(forName: cacheName)
+          }
+          if Preference.bool(for: .thumbnailCacheByContent) {
+            ThumbnailCache.linkContent(ofVideo: currentURL, toName: cacheName)
+          }
         }
       }
       events.emit(.thumbnailsReady)
@@ -0,0 +1,118 @@
+//
+//  PlaylistDiff.swift
+//  iina
+//
+//  Created by agent on 10/16/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Cocoa
+
+/// The changes between two copies of the mpv playlist, used to update the playlist table row by row instead of reloading it.
+///
+/// Entries are matched by the `id` mpv assigns to every playlist entry, which stays the same when the entry is moved. Applied in
+/// order to a table showing the old playlist, the changes are:
+/// 1. remove the rows of `removed`, indexes in the old playlist
+/// 2. perform the moves of `moves` one after another, indexes in the playlist at the time of each move
+/// 3. insert the rows of `inserted`, indexes in the new playlist
+/// 4. reload the rows of `updated`, indexes in the new playlist
+///
+/// Moves are found with a longest increasing subsequence, so only the entries that actually changed their relative order move.
+/// Computing the diff takes O(n log n) for n entries, plus O(n) for every move. The diff is only returned if replaying the moves
+/// gives the new order.
+struct PlaylistDiff {
+
+  /// Maximum number of moves in a diff. Reloading the table is faster than computing and animating more moves.
+  private static let maxMoveCount = 100
+
+  private(set) var removed = IndexSet()
+  private(set) var moves: [(from: Int, to: Int)] = []
+  private(set) var inserted = IndexSet()
+  private(set) var updated = IndexSet()
+
+  var isEmpty: Bool { removed.isEmpty && moves.isEmpty && inserted.isEmpty && updated.isEmpty }
+
+  /// Compute the changes from the old to the new playlist, `nil` if entries cannot be matched because mpv did not provide an
+  /// `id` for all of them or some entries share an `id`, or if more than `maxMoveCount` entries moved.
+  init?(from old: [MPVPlaylistItem], to new: [MPVPlaylistItem]) {
+    var oldIndexes: [Int: Int] = Dictionary(minimumCapacity: old.count)
+    for (index, item) in old.enumerated() {
+      guard item.id > 0, oldIndexes.updateValue(index, forKey: item.id) == nil else { return nil }
+    }
+    var newIDs = Set<Int>(minimumCapacity: new.count)
+    for item in new {
+      guard item.id > 0, newIDs.insert(item.id).inserted else { return nil }
+    }
+
+    // Position in the old playlist of every kept entry, in the order of the new playlist
+    var keptOldIndexes: [Int] = []
+    for (index, item) in new.enumerated() {
+      if let oldIndex = oldIndexes[item.id] {
+        keptOldIndexes.append(oldIndex)
+        if !item.hasSameContent(as: old[oldIndex]) {
+          updated.insert(index)
+        }
+      } else {
+        inserted.insert(index)
+      }
+    }
+    for (index, item) in old.enumerated() where !newIDs.contains(item.id) {
+      removed.insert(index)
+    }
+
+    // After the removals the kept entries are in old order. Entries outside a longest increasing subsequence of old positions
+    // are moved, in new order, to just after the entry preceding them in new order. Entries are only ever moved next to their
+    // predecessor, so no later move separates them again.
+    let staying = PlaylistDiff.longestIncreasingSubsequence(keptOldIndexes)
+    guard staying.count < keptOldIndexes.count else { return }
+    guard keptOldIndexes.count - staying.count <= PlaylistDiff.maxMoveCount else { return nil }
+    var current = keptOldIndexes.sorted()
+    for (target, oldIndex) in keptOldIndexes.enumerated() where !staying.contains(oldIndex) {
+      let from = current.firstIndex(of: oldIndex)!
+      current.remove(at: from)
+      let to = target == 0 ? 0 : current.firstIndex(of: keptOldIndexes[target - 1])! + 1
+      current.insert(oldIndex, at: to)
+      if from != to {
+        moves.append((from, to))
+      }
+    }
+    // The moves have been replayed on `current`, a table updated with them must show the new order
+    guard current == keptOldIndexes else {
+      Logger.log("Playlist diff moves do not produce the new order", level: .error)
+      return nil
+    }
+  }
+
+  /// Returns the elements of a longest strictly increasing subsequence of the given distinct values.
+  private static func longestIncreasingSubsequence(_ values: [Int]) -> Set<Int> {
+    // tails[k] is the index in values of the smallest tail of an increasing subsequence of length k + 1
+    var tails: [Int] = []
+    var predecessors = [Int](repeating: -1, count: values.count)
+    for (index, value) in values.enumerated() {
+      var low = 0, high = tails.count
+      while low < high {
+        let mid = (low + high) / 2
+        if values[tails[mid]] < value {
+          low = mid + 1
+        } else {
+          high = mid
+        }
+      }
+      if low > 0 {
+        predecessors[index] = tails[low - 1]
+      }
+      if low == tails.count {
+        tails.append(index)
+      } else {
+        tails[low] = index
+      }
+    }
+    var result = Set<Int>(minimumCapacity: tails.count)
+    var index = tails.last ?? -1
+    while index >= 0 {
+      result.insert(values[index])
+      index = predecessors[index]
+    }
+    return result
+  }
+}
@@ -38,6 +38,10 @@ class PlaylistViewController: NSViewController, NSTableViewDataSource, NSTableVi
   private var pendingSwitchRequest: TabViewType?
 
   var playlistChangeObserver: NSObjectProtocol?
+  var videoInfoObserver: NSObjectProtocol?
+
+  /// The playlist shown by `playlistTableView`, used to update the table row by row when the playlist changes.
+  private var displayedPlaylist: [MPVPlaylistItem] = []
 
   /** Enum for tab switching */
   enum TabViewType: Int {
@@ -126,6 +130,10 @@ class PlaylistViewController: NSViewController, NSTableViewDataSource, NSTableVi
       self.playlistTotalLengthIsReady = false
       self.reloadData(playlist: true, chapters: false)
     }
+    videoInfoObserver = NotificationCenter.default.addObserver(forName: .iinaPlaylistVideoInfoProbed, object: player, queue: OperationQueue.main) { [unowned self] notification in
+      guard let paths = notification.userInfo?["paths"] as? [String] else { return }
+      self.reloadRows(forProbedFiles: Set(paths))
+    }
 
     // register for double click action
     let action = #selector(performDoubleAction(sender:))
@@ -153,19 +161,70 @@ class PlaylistViewController: NSViewController, NSTableViewDataSource, NSTableVi
 
   deinit {
     NotificationCenter.default.removeObserver(self.playlistChangeObserver!)
+    NotificationCenter.default.removeObserver(self.videoInfoObserver!)
   }
 
   func reloadData(playlist: Bool, chapters: Bool) {
     guard player.info.state.active else { return }
     if playlist {
       player.getPlaylist()
-      playlistTableView.reloadData()
+      updatePlaylistTable()
+      prefetchVideoInfo()
     }
     if chapters {
       chapterTableView.reloadData()
     }
   }
 
+  /// Update `playlistTableView` to the playlist of the player. Only the rows of entries that have been added, removed, moved or
+  /// changed are updated when possible, so changes to a long playlist do not reload the whole table.
+  private func updatePlaylistTable() {
+    let startTime = CACurrentMediaTime()
+    let playlist = player.info.playlist
+    defer { displayedPlaylist = playlist }
+    guard playlistTableView.numberOfRows == displayedPlaylist.count, !displayedPlaylist.isEmpty,
+          let diff = PlaylistDiff(from: displayedPlaylist, to: playlist) else {
+      playlistTableView.reloadData()
+      Logger.log("Reloaded playlist table with \(playlist.count) entries, took \(String(format: "%.2f", (CACurrentMediaTime() - startTime) * 1000))ms",
+                 level: .verbose, subsystem: player.subsystem)
+      return
+    }
+    guard !diff.isEmpty else { return }
+    playlistTableView.beginUpdates()
+    playlistTableView.removeRows(at: diff.removed, withAnimation: AccessibilityPreferences.motionReductionEnabled ? [] : .slideUp)
+    for move in diff.moves {
+      playlistTableView.moveRow(at: move.from, to: move.to)
+    }
+    playlistTableView.insertRows(at: diff.inserted, withAnimation: AccessibilityPreferences.motionReductionEnabled ? [] : .slideDown)
+    playlistTableView.endUpdates()
+    if !diff.updated.isEmpty {
+      playlistTableView.reloadData(forRowIndexes: diff.updated, columnIndexes: IndexSet(integersIn: 0...1))
+    }
+    Logger.log("Updated playlist table with \(playlist.count) entries, \(diff.inserted.count) inserted, \(diff.removed.count) removed, \(diff.moves.count) moved, \(diff.updated.count) changed, took \(String(format: "%.2f", (CACurrentMediaTime() - startTime) * 1000))ms",
+               level: .verbose, subsystem: player.subsystem)
+  }
+
+  /// Probe all files in the playlist whose duration is not cached yet, instead of probing them one by one as their rows are
+  /// displayed.
+  private func prefetchVideoInfo() {
+    guard Preference.bool(for: .prefetchPlaylistVideoDuration) else { return }
+    player.playlistQueue.async {
+      let info = self.player.info
+      let paths = info.playlist.map { $0.filename }.filter { info.getCachedVideoDurationAndProgress($0) == nil }
+      guard !paths.isEmpty else { return }
+      self.player.videoInfoProber.probe(paths)
+    }
+  }
+
+  /// Reload the rows of the given files, which have been probed by `PlayerCore.videoInfoProber`.
+  private func reloadRows(forProbedFiles paths: Set<String>) {
+    let playlist = player.info.playlist
+    let rows = IndexSet(playlist.indices.filter { paths.contains(playlist[$0].filename) })
+    refreshTotalLength()
+    guard !rows.isEmpty else { return }
+    playlistTableView.reloadData(forRowIndexes: rows, columnIndexes: IndexSet(integersIn: 0...1))
+  }
+
   private func showTotalLength() {
     guard let playlistTotalLength = playlistTotalLength, playlistTotalLengthIsReady else { return }
     totalLengthLabel.isHidden = false
@@ -546,18 +605,10 @@ class PlaylistViewController: NSViewController, NSTableViewDataSource, NSTableVi
               self.refreshTotalLength()
             }
           } else {
-            // get related data and schedule a reload
+            // get related data, the row is reloaded when the prober has obtained it. The prober drops
+            // requests for files it is already probing or failed to probe, which avoids looping.
             if Preference.bool(for: .prefetchPlaylistVideoDuration) {
-              self.player.refreshCachedVideoInfo(forVideoPath: item.filename)
-              // Only schedule a reload if data was obtained and cached to avoid looping
-              if let cached = self.player.info.getCachedVideoDurationAndProgress(item.filename),
-                  let duration = cached.duration, duration > 0 {
-                // if FFmpeg got the duration successfully
-                self.refreshTotalLength()
-                DispatchQueue.main.async {
-                  self.playlistTableView.reloadData(forRowIndexes: IndexSet(integer: row), columnIndexes: IndexSet(integersIn: 0...1))
-                }
-              }
+              self.player.videoInfoProber.probe([item.filename])
             }
           }
         }
@@ -161,6 +161,8 @@ class PrefUtilsViewController: PreferenceViewController, PreferenceWindowEmbedda
       guard respond == .alertFirstButtonReturn else { return }
       try? FileManager.default.removeItem(atPath: Utility.thumbnailCacheURL.path)
       Utility.createDirIfNotExist(url: Utility.thumbnailCacheURL)
+      CacheManager.shared.reset()
+      MediaInfoCache.shared.clear()
       self.updateThumbnailCacheStat()
     }
   }
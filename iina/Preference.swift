@@ -324,6 +324,29 @@ struct Preference {
 
     static let enableFFmpegImageDecoder = Key("enableFFmpegImageDecoder")
 
+    /// Number of workers used to generate thumbnails, `0` selects a number based on the number of processor cores.
+    static let thumbnailWorkerCount = Key("thumbnailWorkerCount")
+    /// Generate thumbnails by decoding only the keyframe nearest to each preview point.
+    static let thumbnailKeyframesOnly = Key("thumbnailKeyframesOnly")
+    /// Skip decoding work that is not visible in a thumbnail and decode at a reduced resolution when possible.
+    static let thumbnailFastDecoding = Key("thumbnailFastDecoding")
+    /// Number of threads each thumbnail decoder may use, `0` divides the processor cores between the workers.
+    static let thumbnailDecoderThreadCount = Key("thumbnailDecoderThreadCount")
+    static let thumbnailFrameThreading = Key("thumbnailFrameThreading")
+    /// Generate thumbnails coarse to fine so partial results cover the whole timeline.
+    static let thumbnailProgressiveOrder = Key("thumbnailProgressiveOrder")
+    /// Choose the number of thumbnails from the duration of the video and the width of the seek bar.
+    static let thumbnailAdaptiveDensity = Key("thumbnailAdaptiveDensity")
+    /// Look a few frames further for a thumbnail when the frame at a preview point is blank or repeats its neighbour.
+    static let thumbnailSceneAwareSampling = Key("thumbnailSceneAwareSampling")
+    /// Also find cached thumbnails by a hash of sampled parts of the video, so they survive moving, renaming and copying it.
+    static let thumbnailCacheByContent = Key("thumbnailCacheByContent")
+    /// Maximum number of connections used to generate thumbnails of network resources and files on remote drives.
+    static let thumbnailNetworkConnectionCount = Key("thumbnailNetworkConnectionCount")
+    /// Maximum number of bytes per second read to generate thumbnails of network resources and files on remote drives, `0`
+    /// for no limit.
+    static let thumbnailNetworkByteRate = Key("thumbnailNetworkByteRate")
+
     /// The belief is that the workaround for issue #3844 that adds a tiny subview to the player window is no longer needed.
     /// To confirm this the workaround is being disabled by default using this preference. Should all go well this workaround will be
     /// removed in the future.
@@ -960,6 +983,17 @@ struct Preference {
     .recentDocuments: [Any](),
 
     .enableFFmpegImageDecoder: true,
+    .thumbnailWorkerCount: 0,
+    .thumbnailKeyframesOnly: false,
+    .thumbnailFastDecoding: true,
+    .thumbnailDecoderThreadCount: 0,
+    .thumbnailFrameThreading: false,
+    .thumbnailProgressiveOrder: true,
+    .thumbnailAdaptiveDensity: true,
+    .thumbnailSceneAwareSampling: false,
+    .thumbnailCacheByContent: true,
+    .thumbnailNetworkConnectionCount: 2,
+    .thumbnailNetworkByteRate: 4 * 1024 * 1024,
     .enableHdrWorkaround: false
   ]
 
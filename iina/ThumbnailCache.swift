@@ -14,15 +14,75 @@ class ThumbnailCache {
   private typealias CacheVersion = UInt8
   private typealias FileSize = UInt64
   private typealias FileTimestamp = Int64
+  private typealias EntryCount = UInt32
+  private typealias EntryOffset = UInt64
+
+  /// Version 3 layout, all values in native byte order:
+  /// ```
+  /// [version][video file size][video modification time]
+  /// [entry count]
+  /// [timestamp][offset][length] × entry count
+  /// [JPEG data] × entry count
+  /// ```
+  /// The offset and timestamp table allows the file to be memory mapped and each image to be decoded when it is first
+  /// displayed, instead of reading and decoding every image up front.
+  private static let version: CacheVersion = 3
+  /// Version 2 files are a run of `[length][timestamp][JPEG data]` blocks after the metadata. They are migrated to the
+  /// current version when read.
+  private static let legacyVersion: CacheVersion = 2
 
-  private static let version: CacheVersion = 2
-  
   private static let sizeofMetadata = MemoryLayout<CacheVersion>.size + MemoryLayout<FileSize>.size + MemoryLayout<FileTimestamp>.size
+  private static let sizeofEntry = MemoryLayout<Double>.size + 2 * MemoryLayout<EntryOffset>.size
+
+  /// Partial results of an interrupted job are kept in a separate file that is appended to while thumbnails are generated:
+  /// ```
+  /// [version][video file size][video modification time]
+  /// [thumbnail count]
+  /// [bitmap of processed preview points]
+  /// [preview point][timestamp][length][JPEG data] × processed preview points
+  /// ```
+  /// Records are appended before their bits are set, so a preview point is only considered processed once its record is
+  /// complete. Preview points that did not produce a thumbnail have a record with a length of 0.
+  private typealias PointIndex = UInt32
+  private typealias RecordLength = UInt32
+  private static let partialExtension = "partial"
+  private static let sizeofRecordHeader = MemoryLayout<PointIndex>.size + MemoryLayout<Double>.size + MemoryLayout<RecordLength>.size
+
+  /// A cache file is also found by the contents of its video, so thumbnails are not generated again after the video has been
+  /// moved, renamed or copied. The content key is the MD5 hash of the size of the video and of a few chunks sampled from it,
+  /// similar to the Open Subtitles hash. The content key file, named after the content key, holds the name of the cache file.
+  private static let contentKeyExtension = "content"
+  private static let contentKeyChunkSize = 64 * 1024
+  private static let contentKeyChunkCount = 4
 
   private static let imageProperties: [NSBitmapImageRep.PropertyKey: Any] = [
     .compressionFactor: 0.75
   ]
-  
+
+  /// A thumbnail whose image is decoded from the memory mapped cache file when it is first requested.
+  private class MappedThumbnail: FFThumbnail {
+    /// The mapped cache file. Copies of `Data` share the mapping.
+    private let file: Data
+    private let range: Range<Int>
+
+    init(file: Data, range: Range<Int>, realTime: Double) {
+      self.file = file
+      self.range = range
+      super.init()
+      self.realTime = realTime
+    }
+
+    override var image: NSImage? {
+      get {
+        if let image = super.image { return image }
+        let image = NSImage(data: file.subdata(in: range))
+        super.image = image
+        return image
+      }
+      set { super.image = newValue }
+    }
+  }
+
   private static func log(_ message: String, level: Logger.Level = .debug) {
     Logger.log(message, level: level, subsystem: subsystem)
   }
@@ -32,23 +92,7 @@ class ThumbnailCache {
   }
 
   static func fileIsCached(forName name: String, forVideo videoPath: URL?) -> Bool {
-    guard let fileAttr = try? FileManager.default.attributesOfItem(atPath: videoPath!.path) else {
-      log("Cannot get video file attributes", level: .error)
-      return false
-    }
-
-    // file size
-    guard let fileSize = fileAttr[.size] as? FileSize else {
-      log("Cannot get video file size", level: .error)
-      return false
-    }
-
-    // modified date
-    guard let fileModifiedDate = fileAttr[.modificationDate] as? Date else {
-      log("Cannot get video file modification date", level: .error)
-      return false
-    }
-    let fileTimestamp = FileTimestamp(fileModifiedDate.timeIntervalSince1970)
+    guard let (fileSize, fileTimestamp) = videoFileMetadata(videoPath) else { return false }
 
     // Check metadate in the cache
     if self.fileExists(forName: name) {
@@ -58,7 +102,7 @@ class ThumbnailCache {
       }
 
       let cacheVersion = file.read(type: CacheVersion.self)
-      if cacheVersion != version { return false }
+      if cacheVersion != version && cacheVersion != legacyVersion { return false }
 
       return file.read(type: FileSize.self) == fileSize &&
         file.read(type: FileTimestamp.self) == fileTimestamp
@@ -67,125 +111,412 @@ class ThumbnailCache {
     return false
   }
 
+  /// Returns the name of a valid cache file of a video with the same contents as the given video, which may be at another path.
+  static func nameForContent(ofVideo videoPath: URL) -> String? {
+    guard let key = contentKey(ofVideo: videoPath),
+          let nameData = try? Data(contentsOf: contentKeyURLFor(key)) else { return nil }
+    let name = String(decoding: nameData, as: UTF8.self)
+    // The modification time is not compared, copies do not always keep it
+    guard let (fileSize, _) = videoFileMetadata(videoPath), let file = try? FileHandle(forReadingFrom: urlFor(name)) else { return nil }
+    defer { file.closeFile() }
+    let cacheVersion = file.read(type: CacheVersion.self)
+    guard cacheVersion == version || cacheVersion == legacyVersion, file.read(type: FileSize.self) == fileSize else { return nil }
+    CacheManager.shared.didAccess(contentKeyURLFor(key))
+    return name
+  }
+
+  /// Record that the cache file with the given name holds the thumbnails of the contents of the given video.
+  static func linkContent(ofVideo videoPath: URL, toName name: String) {
+    guard let key = contentKey(ofVideo: videoPath) else { return }
+    let pathURL = contentKeyURLFor(key)
+    let nameData = Data(name.utf8)
+    do {
+      try nameData.write(to: pathURL, options: .atomic)
+    } catch {
+      log("Cannot write content key file: \(error)", level: .error)
+      return
+    }
+    CacheManager.shared.didWrite(pathURL, size: nameData.count)
+  }
+
+  /// Returns the content key of the given video, reading at most `contentKeyChunkCount` chunks of it.
+  private static func contentKey(ofVideo videoPath: URL) -> String? {
+    guard let file = try? FileHandle(forReadingFrom: videoPath) else { return nil }
+    defer { file.closeFile() }
+    let fileSize = file.seekToEndOfFile()
+    guard fileSize > 0 else { return nil }
+    var data = Data(bytesOf: fileSize)
+    // Chunks at the start, the end and evenly spaced in between
+    let lastOffset = fileSize > UInt64(contentKeyChunkSize) ? fileSize - UInt64(contentKeyChunkSize) : 0
+    for chunk in 0..<contentKeyChunkCount {
+      file.seek(toFileOffset: lastOffset * UInt64(chunk) / UInt64(contentKeyChunkCount - 1))
+      data.append(file.readData(ofLength: contentKeyChunkSize))
+    }
+    return data.md5
+  }
+
   /// Write thumbnail cache to file.
   /// This method is expected to be called when the file doesn't exist.
   static func write(_ thumbnails: [FFThumbnail], forName name: String, forVideo videoPath: URL?) {
     log("Writing thumbnail cache...")
+    let startTime = CACurrentMediaTime()
 
-    let maxCacheSize = Preference.integer(for: .maxThumbnailPreviewCacheSize) * FloatingPointByteCountFormatter.PrefixFactor.mi.rawValue
-    if maxCacheSize == 0 {
-      return
-    } else if CacheManager.shared.getCacheSize() > maxCacheSize {
-      CacheManager.shared.clearOldCache()
+    guard makeRoomForCache() else { return }
+
+    guard let (fileSize, fileTimestamp) = videoFileMetadata(videoPath) else { return }
+
+    // images
+    var entries: [(timestamp: Double, jpegData: Data)] = []
+    for tb in thumbnails {
+      guard let jpegData = encode(tb) else { return }
+      entries.append((tb.realTime, jpegData))
     }
 
+    guard writeFile(at: urlFor(name), fileSize: fileSize, fileTimestamp: fileTimestamp, entries: entries) else { return }
+
+    let time = (CACurrentMediaTime() - startTime) * 1000
+    log("Finished writing thumbnail cache, took \(String(format: "%.2f", time))ms, \(CacheManager.shared.getEntryCount()) files in cache")
+  }
+
+  /// Add the given thumbnails to a valid cache file, such as the thumbnails found when refining a complete job.
+  ///
+  /// Only the new thumbnails are encoded, the images already in the file are copied as they are. The entry table comes before
+  /// the images, so the file is still written again.
+  static func append(_ thumbnails: [FFThumbnail], forName name: String, forVideo videoPath: URL?) {
+    guard fileIsCached(forName: name, forVideo: videoPath), makeRoomForCache(),
+          let (fileSize, fileTimestamp) = videoFileMetadata(videoPath) else { return }
+    log("Appending \(thumbnails.count) thumbnails to thumbnail cache...")
     let pathURL = urlFor(name)
-    guard FileManager.default.createFile(atPath: pathURL.path, contents: nil, attributes: nil) else {
-      log("Cannot create file.", level: .error)
+    guard var data = try? Data(contentsOf: pathURL, options: .alwaysMapped) else {
+      log("Cannot open file.", level: .error)
       return
     }
-    guard let file = try? FileHandle(forWritingTo: pathURL) else {
-      log("Cannot write to file.", level: .error)
+    if data.read(type: CacheVersion.self, at: 0) == legacyVersion, let migrated = migrateLegacyFile(data, at: pathURL) {
+      data = migrated
+    }
+    guard let existing = readEntries(data) else {
+      log("Cannot read cache entries.", level: .error)
       return
     }
+    var entries = existing.map { (timestamp: $0.timestamp, jpegData: data.subdata(in: $0.range)) }
+    for tb in thumbnails {
+      guard let jpegData = encode(tb) else { return }
+      entries.append((tb.realTime, jpegData))
+    }
+    entries.sort { $0.timestamp < $1.timestamp }
+    guard writeFile(at: pathURL, fileSize: fileSize, fileTimestamp: fileTimestamp, entries: entries) else { return }
+    log("Finished appending to thumbnail cache, \(entries.count) in total")
+  }
 
-    // version
-    let versionData = Data(bytesOf: version)
-    file.write(versionData)
+  /// Turn the partial cache of a job that has processed every preview point into a complete cache, reusing the encoded images.
+  /// - Returns: `true` if the complete cache was written.
+  static func completePartial(forName name: String, forVideo videoPath: URL?) -> Bool {
+    guard let partial = readPartialFile(forName: name, forVideo: videoPath),
+          partial.processed.count == partial.thumbnailCount + 1 else { return false }
+    log("Completing partial thumbnail cache...")
+    guard makeRoomForCache(), let (fileSize, fileTimestamp) = videoFileMetadata(videoPath) else { return false }
+    let entries = partial.records.sorted { $0.timestamp < $1.timestamp }.map {
+      (timestamp: $0.timestamp, jpegData: partial.data.subdata(in: $0.range))
+    }
+    guard writeFile(at: urlFor(name), fileSize: fileSize, fileTimestamp: fileTimestamp, entries: entries) else { return false }
+    deletePartial(forName: name)
+    log("Finished writing thumbnail cache.")
+    return true
+  }
 
-    guard let fileAttr = try? FileManager.default.attributesOfItem(atPath: videoPath!.path) else {
-      log("Cannot get video file attributes", level: .error)
-      return
+  /// Add the given processed preview points to the partial cache, creating the file if needed.
+  /// - Parameters:
+  ///   - points: The processed preview points.
+  ///   - thumbnails: The thumbnails of the processed preview points that produced one.
+  ///   - thumbnailCount: The number of intervals the timeline was divided into.
+  static func appendPartial(points: IndexSet, thumbnails: [Int: FFThumbnail], thumbnailCount: Int,
+                            forName name: String, forVideo videoPath: URL?) {
+    guard Preference.integer(for: .maxThumbnailPreviewCacheSize) != 0,
+          let (fileSize, fileTimestamp) = videoFileMetadata(videoPath) else { return }
+    let pathURL = partialURLFor(name)
+    let bitmapOffset = sizeofMetadata + MemoryLayout<EntryCount>.size
+    let bitmapSize = (thumbnailCount + 1 + 7) / 8
+
+    // Start over unless the file belongs to the same video and preview points
+    let existing = try? FileHandle(forReadingFrom: pathURL)
+    let matches = existing?.read(type: CacheVersion.self) == version && existing?.read(type: FileSize.self) == fileSize &&
+      existing?.read(type: FileTimestamp.self) == fileTimestamp && existing?.read(type: EntryCount.self) == EntryCount(thumbnailCount)
+    existing?.closeFile()
+    if !matches {
+      var header = Data()
+      header.append(Data(bytesOf: version))
+      header.append(Data(bytesOf: fileSize))
+      header.append(Data(bytesOf: fileTimestamp))
+      header.append(Data(bytesOf: EntryCount(thumbnailCount)))
+      header.append(Data(count: bitmapSize))
+      guard FileManager.default.createFile(atPath: pathURL.path, contents: header, attributes: nil) else {
+        log("Cannot create partial cache file.", level: .error)
+        return
+      }
     }
 
-    // file size
-    guard let fileSize = fileAttr[.size] as? FileSize else {
-      log("Cannot get video file size", level: .error)
+    // records
+    var records = Data()
+    for point in points where point <= thumbnailCount {
+      var jpegData = Data()
+      if let tb = thumbnails[point] {
+        guard let data = encode(tb) else { return }
+        jpegData = data
+      }
+      records.append(Data(bytesOf: PointIndex(point)))
+      records.append(Data(bytesOf: thumbnails[point]?.realTime ?? 0))
+      records.append(Data(bytesOf: RecordLength(jpegData.count)))
+      records.append(jpegData)
+    }
+    guard let file = try? FileHandle(forUpdating: pathURL) else {
+      log("Cannot write to partial cache file.", level: .error)
       return
     }
-    let fileSizeData = Data(bytesOf: fileSize)
-    file.write(fileSizeData)
-
-    // modified date
-    guard let fileModifiedDate = fileAttr[.modificationDate] as? Date else {
-      log("Cannot get video file modification date", level: .error)
+    defer { file.closeFile() }
+    file.seekToEndOfFile()
+    file.write(records)
+    file.synchronizeFile()
+    CacheManager.shared.didWrite(pathURL, size: Int(file.offsetInFile))
+
+    // bitmap, updated only after the records are on disk
+    file.seek(toFileOffset: UInt64(bitmapOffset))
+    var bitmap = [UInt8](file.readData(ofLength: bitmapSize))
+    guard bitmap.count == bitmapSize else {
+      log("Cannot read partial cache bitmap.", level: .error)
       return
     }
-    let fileTimestamp = FileTimestamp(fileModifiedDate.timeIntervalSince1970)
-    let fileModificationDateData = Data(bytesOf: fileTimestamp)
-    file.write(fileModificationDateData)
+    for point in points where point <= thumbnailCount {
+      bitmap[point / 8] |= 1 << (point % 8)
+    }
+    file.seek(toFileOffset: UInt64(bitmapOffset))
+    file.write(Data(bitmap))
+  }
 
-    // data blocks
-    for tb in thumbnails {
-      let timestampData = Data(bytesOf: tb.realTime)
-      guard let tiffData = tb.image?.tiffRepresentation else {
-        log("Cannot generate tiff data.", level: .error)
-        return
-      }
-      guard let jpegData = NSBitmapImageRep(data: tiffData)?.representation(using: .jpeg, properties: imageProperties) else {
-        log("Cannot generate jpeg data.", level: .error)
-        return
-      }
-      let blockLength = Int64(timestampData.count + jpegData.count)
-      let blockLengthData = Data(bytesOf: blockLength)
-      file.write(blockLengthData)
-      file.write(timestampData)
-      file.write(jpegData)
+  /// Read the partial cache of an interrupted job.
+  /// - Returns: The state needed to resume the job, or `nil` if there is no valid partial cache.
+  static func readPartial(forName name: String, forVideo videoPath: URL?) -> FFThumbnailResumeState? {
+    guard let partial = readPartialFile(forName: name, forVideo: videoPath) else { return nil }
+    CacheManager.shared.didAccess(partialURLFor(name))
+    var thumbnails: [NSNumber: FFThumbnail] = [:]
+    for record in partial.records {
+      thumbnails[NSNumber(value: record.point)] = MappedThumbnail(file: partial.data, range: record.range,
+                                                                   realTime: record.timestamp)
     }
+    let state = FFThumbnailResumeState()
+    state.thumbnailCount = partial.thumbnailCount
+    state.processedPoints = partial.processed
+    state.thumbnails = thumbnails
+    log("Found partial thumbnail cache, \(partial.processed.count) of \(partial.thumbnailCount + 1) preview points processed")
+    return state
+  }
 
-    CacheManager.shared.needsRefresh = true
-    log("Finished writing thumbnail cache.")
+  static func deletePartial(forName name: String) {
+    let pathURL = partialURLFor(name)
+    guard FileManager.default.fileExists(atPath: pathURL.path) else { return }
+    deleteCacheFile(at: pathURL)
+  }
+
+  /// Memory map and parse the partial cache file, deleting it if it is outdated or corrupt.
+  /// - Returns: The processed preview points and the records of the thumbnails they produced.
+  private static func readPartialFile(forName name: String, forVideo videoPath: URL?)
+      -> (data: Data, thumbnailCount: Int, processed: IndexSet, records: [(point: Int, timestamp: Double, range: Range<Int>)])? {
+    let pathURL = partialURLFor(name)
+    guard FileManager.default.fileExists(atPath: pathURL.path) else { return nil }
+    guard let (fileSize, fileTimestamp) = videoFileMetadata(videoPath),
+          let data = try? Data(contentsOf: pathURL, options: .alwaysMapped),
+          data.read(type: CacheVersion.self, at: 0) == version,
+          data.read(type: FileSize.self, at: MemoryLayout<CacheVersion>.size) == fileSize,
+          data.read(type: FileTimestamp.self, at: MemoryLayout<CacheVersion>.size + MemoryLayout<FileSize>.size) == fileTimestamp,
+          let count = data.read(type: EntryCount.self, at: sizeofMetadata) else {
+      log("Partial thumbnail cache is outdated or corrupt. Cache file will be deleted.", level: .warning)
+      deleteCacheFile(at: pathURL)
+      return nil
+    }
+    let thumbnailCount = Int(count)
+    let bitmapOffset = sizeofMetadata + MemoryLayout<EntryCount>.size
+    let bitmapSize = (thumbnailCount + 1 + 7) / 8
+
+    var processed = IndexSet()
+    var records: [(point: Int, timestamp: Double, range: Range<Int>)] = []
+    var offset = bitmapOffset + bitmapSize
+    // A record cut short by an interruption ends the file, its bit was never set.
+    while let point = data.read(type: PointIndex.self, at: offset),
+          let timestamp = data.read(type: Double.self, at: offset + MemoryLayout<PointIndex>.size),
+          let length = data.read(type: RecordLength.self, at: offset + MemoryLayout<PointIndex>.size + MemoryLayout<Double>.size),
+          offset + sizeofRecordHeader + Int(length) <= data.count {
+      let point = Int(point)
+      let start = offset + sizeofRecordHeader
+      offset = start + Int(length)
+      guard point <= thumbnailCount, let bits = data.read(type: UInt8.self, at: bitmapOffset + point / 8),
+            bits & (1 << (point % 8)) != 0 else { continue }
+      processed.insert(point)
+      if length > 0 {
+        records.append((point, timestamp, start..<start + Int(length)))
+      }
+    }
+    return (data, thumbnailCount, processed, records)
   }
 
   /// Read thumbnail cache to file.
   /// This method is expected to be called when the file exists.
+  ///
+  /// The file is memory mapped and only the entry table is read, images are decoded when they are first displayed.
   static func read(forName name: String) -> [FFThumbnail]? {
     log("Reading thumbnail cache...")
+    let startTime = CACurrentMediaTime()
 
     let pathURL = urlFor(name)
-    guard let file = try? FileHandle(forReadingFrom: pathURL) else {
+    guard var data = try? Data(contentsOf: pathURL, options: .alwaysMapped) else {
       log("Cannot open file.", level: .error)
       return nil
     }
     log("Reading from \(pathURL.path)")
 
-    var result: [FFThumbnail] = []
+    if data.read(type: CacheVersion.self, at: 0) == legacyVersion {
+      guard let migrated = migrateLegacyFile(data, at: pathURL) else {
+        log("Cannot migrate legacy cache. Cache file will be deleted.", level: .warning)
+        deleteCacheFile(at: pathURL)
+        return nil
+      }
+      data = migrated
+    }
 
-    // get file length
-    file.seekToEndOfFile()
-    let eof = file.offsetInFile
+    guard let entries = readEntries(data) else {
+      log("Cannot read cache entries. Cache file will be deleted.", level: .warning)
+      deleteCacheFile(at: pathURL)
+      return nil
+    }
+    let result: [FFThumbnail] = entries.map { MappedThumbnail(file: data, range: $0.range, realTime: $0.timestamp) }
+    CacheManager.shared.didAccess(pathURL)
 
-    // skip metadata
-    file.seek(toFileOffset: UInt64(sizeofMetadata))
+    log("Finished reading thumbnail cache, \(result.count) in total, took \(String(format: "%.2f", (CACurrentMediaTime() - startTime) * 1000))ms")
+    return result
+  }
+
+  /// Returns the timestamp and the range of the JPEG data of every entry in the contents of a current version cache file, or
+  /// `nil` if the file is corrupt.
+  private static func readEntries(_ data: Data) -> [(timestamp: Double, range: Range<Int>)]? {
+    guard data.read(type: CacheVersion.self, at: 0) == version,
+          let count = data.read(type: EntryCount.self, at: sizeofMetadata) else { return nil }
+    var entries: [(timestamp: Double, range: Range<Int>)] = []
+    entries.reserveCapacity(Int(count))
+    var entryOffset = sizeofMetadata + MemoryLayout<EntryCount>.size
+    for _ in 0..<count {
+      guard let timestamp = data.read(type: Double.self, at: entryOffset),
+            let offset = data.read(type: EntryOffset.self, at: entryOffset + MemoryLayout<Double>.size),
+            let length = data.read(type: EntryOffset.self, at: entryOffset + MemoryLayout<Double>.size + MemoryLayout<EntryOffset>.size),
+            offset <= UInt64(data.count), length <= UInt64(data.count) - offset else { return nil }
+      entries.append((timestamp, Int(offset)..<Int(offset + length)))
+      entryOffset += sizeofEntry
+    }
+    return entries
+  }
+
+  /// Convert a version 2 cache file to the current version, reusing the encoded images.
+  /// - Returns: The contents of the converted file, memory mapped, or `nil` if the file is corrupt.
+  private static func migrateLegacyFile(_ data: Data, at pathURL: URL) -> Data? {
+    log("Migrating thumbnail cache from version \(legacyVersion) to \(version)")
+    guard let fileSize = data.read(type: FileSize.self, at: MemoryLayout<CacheVersion>.size),
+          let fileTimestamp = data.read(type: FileTimestamp.self, at: MemoryLayout<CacheVersion>.size + MemoryLayout<FileSize>.size) else {
+      return nil
+    }
 
     // data blocks
-    while file.offsetInFile != eof {
-      // length and timestamp
-      guard let blockLength = file.read(type: Int64.self),
-            let timestamp = file.read(type: Double.self) else {
-        log("Cannot read image header. Cache file will be deleted.", level: .warning)
-        file.closeFile()
-        deleteCacheFile(at: pathURL)
+    var entries: [(timestamp: Double, jpegData: Data)] = []
+    var offset = sizeofMetadata
+    while offset != data.count {
+      guard let blockLength = data.read(type: Int64.self, at: offset),
+            let timestamp = data.read(type: Double.self, at: offset + MemoryLayout<Int64>.size) else {
         return nil
       }
-      // jpeg
-      let jpegData = file.readData(ofLength: Int(blockLength) - MemoryLayout.size(ofValue: timestamp))
-      guard let image = NSImage(data: jpegData) else {
-        log("Cannot read image. Cache file will be deleted.", level: .warning)
-        file.closeFile()
-        deleteCacheFile(at: pathURL)
-        return nil
-      }
-      // construct
-      let tb = FFThumbnail()
-      tb.realTime = timestamp
-      tb.image = image
-      result.append(tb)
+      let jpegStart = offset + MemoryLayout<Int64>.size + MemoryLayout<Double>.size
+      let jpegEnd = offset + MemoryLayout<Int64>.size + Int(blockLength)
+      guard jpegStart <= jpegEnd, jpegEnd <= data.count else { return nil }
+      entries.append((timestamp, data.subdata(in: jpegStart..<jpegEnd)))
+      offset = jpegEnd
     }
 
-    file.closeFile()
-    log("Finished reading thumbnail cache, \(result.count) in total")
-    return result
+    guard writeFile(at: pathURL, fileSize: fileSize, fileTimestamp: fileTimestamp, entries: entries) else { return nil }
+    return try? Data(contentsOf: pathURL, options: .alwaysMapped)
+  }
+
+  private static func writeFile(at pathURL: URL, fileSize: FileSize, fileTimestamp: FileTimestamp,
+                                entries: [(timestamp: Double, jpegData: Data)]) -> Bool {
+    var data = Data()
+    // metadata
+    data.append(Data(bytesOf: version))
+    data.append(Data(bytesOf: fileSize))
+    data.append(Data(bytesOf: fileTimestamp))
+
+    // entry table
+    data.append(Data(bytesOf: EntryCount(entries.count)))
+    var offset = EntryOffset(data.count + entries.count * sizeofEntry)
+    for entry in entries {
+      data.append(Data(bytesOf: entry.timestamp))
+      data.append(Data(bytesOf: offset))
+      data.append(Data(bytesOf: EntryOffset(entry.jpegData.count)))
+      offset += EntryOffset(entry.jpegData.count)
+    }
+
+    // images
+    for entry in entries {
+      data.append(entry.jpegData)
+    }
+
+    do {
+      // Written atomically so a mapped copy of a file being replaced stays valid.
+      try data.write(to: pathURL, options: .atomic)
+    } catch {
+      log("Cannot write to file: \(error)", level: .error)
+      return false
+    }
+    CacheManager.shared.didWrite(pathURL, size: data.count)
+    return true
+  }
+
+  /// Make sure the cache is below its maximum size.
+  /// - Returns: `false` if caching is disabled.
+  private static func makeRoomForCache() -> Bool {
+    let maxCacheSize = Preference.integer(for: .maxThumbnailPreviewCacheSize) * FloatingPointByteCountFormatter.PrefixFactor.mi.rawValue
+    guard maxCacheSize != 0 else { return false }
+    // Old files are removed in the background, the cache manager tracks the size of the cache
+    CacheManager.shared.clearOldCache()
+    return true
+  }
+
+  private static func encode(_ tb: FFThumbnail) -> Data? {
+    // Encode straight from the pixels of the thumbnail instead of going through TIFF
+    guard let cgImage = tb.createCGImage() else {
+      log("Cannot create image.", level: .error)
+      return nil
+    }
+    guard let jpegData = NSBitmapImageRep(cgImage: cgImage).representation(using: .jpeg, properties: imageProperties) else {
+      log("Cannot generate jpeg data.", level: .error)
+      return nil
+    }
+    return jpegData
+  }
+
+  /// Returns the size and modification time of the video file used to validate a cache file.
+  private static func videoFileMetadata(_ videoPath: URL?) -> (FileSize, FileTimestamp)? {
+    guard let videoPath else { return nil }
+    guard let fileAttr = try? FileManager.default.attributesOfItem(atPath: videoPath.path) else {
+      log("Cannot get video file attributes", level: .error)
+      return nil
+    }
+
+    // file size
+    guard let fileSize = fileAttr[.size] as? FileSize else {
+      log("Cannot get video file size", level: .error)
+      return nil
+    }
+
+    // modified date
+    guard let fileModifiedDate = fileAttr[.modificationDate] as? Date else {
+      log("Cannot get video file modification date", level: .error)
+      return nil
+    }
+    return (fileSize, FileTimestamp(fileModifiedDate.timeIntervalSince1970))
   }
 
   private static func deleteCacheFile(at pathURL: URL) {
@@ -195,10 +526,19 @@ class ThumbnailCache {
     } catch {
       log("Cannot delete corrupted cache.", level: .error)
     }
+    CacheManager.shared.didRemove(pathURL)
   }
 
   private static func urlFor(_ name: String) -> URL {
     return Utility.thumbnailCacheURL.appendingPathComponent(name)
   }
 
+  private static func contentKeyURLFor(_ key: String) -> URL {
+    return urlFor(key).appendingPathExtension(contentKeyExtension)
+  }
+
+  private static func partialURLFor(_ name: String) -> URL {
+    return urlFor(name).appendingPathExtension(partialExtension)
+  }
+
 }
@@ -0,0 +1,140 @@
+//
+//  ThumbnailIndex.swift
+//  iina
+//
+//  Created by agent on 10/16/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+/// An immutable snapshot of the thumbnails of a video, sorted by time and optimized for lookups by time.
+///
+/// Lookups happen on every mouse move over the play slider and every redraw of the touch bar slider, while the thumbnail
+/// generator keeps adding thumbnails. Adding thumbnails creates a new index instead of modifying the current one, so readers
+/// holding a snapshot never wait for the generator. See `PlaybackInfo.appendThumbnails`.
+final class ThumbnailIndex {
+
+  let thumbnails: [FFThumbnail]
+
+  /// Times of the thumbnails, kept in their own array so lookups do not touch the thumbnail objects.
+  private let timestamps: [Double]
+
+  /// Time of the first thumbnail and the distance between thumbnails if they are evenly spaced, allowing the position of
+  /// a time to be calculated instead of searched for.
+  private let spacing: (start: Double, step: Double)?
+
+  /// Maximum number of positions a calculated position is corrected by before falling back to a binary search.
+  private static let maxSpacingCorrection = 4
+
+  var count: Int { thumbnails.count }
+
+  var isEmpty: Bool { thumbnails.isEmpty }
+
+  convenience init(_ thumbnails: [FFThumbnail] = []) {
+    self.init(sorted: ThumbnailIndex.sorted(thumbnails))
+  }
+
+  private init(sorted thumbnails: [FFThumbnail]) {
+    self.thumbnails = thumbnails
+    timestamps = thumbnails.map { $0.realTime }
+    spacing = ThumbnailIndex.detectSpacing(timestamps)
+  }
+
+  /// Return a new index containing the thumbnails of this index and the given thumbnails.
+  ///
+  /// Only the given thumbnails are sorted, they are then merged with the thumbnails of this index in linear time. Thumbnails
+  /// generated coarse to fine arrive in batches spread over the whole timeline, so appending them must not sort everything again.
+  func appending(_ newThumbnails: [FFThumbnail]) -> ThumbnailIndex {
+    guard !newThumbnails.isEmpty else { return self }
+    let added = ThumbnailIndex.sorted(newThumbnails)
+    var merged: [FFThumbnail] = []
+    merged.reserveCapacity(thumbnails.count + added.count)
+    var i = 0, j = 0
+    while i < thumbnails.count && j < added.count {
+      if added[j].realTime < timestamps[i] {
+        merged.append(added[j])
+        j += 1
+      } else {
+        merged.append(thumbnails[i])
+        i += 1
+      }
+    }
+    merged.append(contentsOf: thumbnails[i...])
+    merged.append(contentsOf: added[j...])
+    return ThumbnailIndex(sorted: merged)
+  }
+
+  /// Return the given thumbnails sorted by time, without sorting them if they already are.
+  private static func sorted(_ thumbnails: [FFThumbnail]) -> [FFThumbnail] {
+    for i in thumbnails.indices.dropFirst() where thumbnails[i - 1].realTime > thumbnails[i].realTime {
+      return thumbnails.sorted { $0.realTime < $1.realTime }
+    }
+    return thumbnails
+  }
+
+  /// Return the thumbnail preceding the given time.
+  func thumbnail(forSecond sec: Double) -> FFThumbnail? {
+    guard !timestamps.isEmpty else { return nil }
+    let index = firstIndex(atOrAfter: sec)
+    if index == timestamps.count { return thumbnails.last! }
+    return thumbnails[index == 0 ? index : index - 1]
+  }
+
+  /// Return the thumbnail closest to the given time.
+  func nearestThumbnail(forSecond sec: Double) -> FFThumbnail? {
+    guard !timestamps.isEmpty else { return nil }
+    let index = firstIndex(atOrAfter: sec)
+    if index == timestamps.count { return thumbnails.last! }
+    if index == 0 || timestamps[index] - sec < sec - timestamps[index - 1] { return thumbnails[index] }
+    return thumbnails[index - 1]
+  }
+
+  /// Return the thumbnails before and after the given time, or `nil` if the time is not between two thumbnails.
+  func surroundingThumbnails(forSecond sec: Double) -> (before: FFThumbnail, after: FFThumbnail)? {
+    let index = firstIndex(atOrAfter: sec)
+    guard index > 0, index < timestamps.count else { return nil }
+    return (thumbnails[index - 1], thumbnails[index])
+  }
+
+  /// Return the index of the first thumbnail at or after the given time, or `count` if there is none.
+  private func firstIndex(atOrAfter sec: Double) -> Int {
+    if let spacing = spacing, sec.isFinite {
+      // Calculate the position, then correct it for thumbnails that are not exactly where expected.
+      // Clamp before converting, converting a position beyond the range of `Int` traps
+      let position = ((sec - spacing.start) / spacing.step).rounded(.up)
+      var index = position.isNaN ? 0 : Int(min(max(position, 0), Double(timestamps.count)))
+      for _ in 0..<ThumbnailIndex.maxSpacingCorrection {
+        if index > 0 && timestamps[index - 1] >= sec {
+          index -= 1
+        } else if index < timestamps.count && timestamps[index] < sec {
+          index += 1
+        } else {
+          return index
+        }
+      }
+    }
+    var low = 0
+    var high = timestamps.count
+    while low < high {
+      let mid = (low + high) / 2
+      if timestamps[mid] < sec {
+        low = mid + 1
+      } else {
+        high = mid
+      }
+    }
+    return low
+  }
+
+  /// Return the start and step of the given sorted times if every time is within half a step of where an evenly spaced
+  /// time would be.
+  private static func detectSpacing(_ timestamps: [Double]) -> (start: Double, step: Double)? {
+    guard timestamps.count > 2, let first = timestamps.first, let last = timestamps.last, last > first else { return nil }
+    let step = (last - first) / Double(timestamps.count - 1)
+    for (i, timestamp) in timestamps.enumerated() where abs(timestamp - (first + step * Double(i))) > step / 2 {
+      return nil
+    }
+    return (first, step)
+  }
+}
@@ -0,0 +1,574 @@
+//
+//  ThumbnailScaler.c
+//  iina
+//
+//  Created by agent on 10/16/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#include "ThumbnailScaler.h"
+
+#include <math.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/sysctl.h>
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdocumentation"
+#include <libavutil/mastering_display_metadata.h>
+#include <libavutil/pixfmt.h>
+#pragma clang diagnostic pop
+
+// Vectors of eight samples. Clang translates operations on these into SSE or AVX2 instructions on Intel and NEON
+// instructions on Apple silicon, so the kernel is written once for all of them.
+typedef uint8_t u8x8 __attribute__((ext_vector_type(8)));
+typedef uint16_t u16x8 __attribute__((ext_vector_type(8)));
+typedef uint32_t u32x8 __attribute__((ext_vector_type(8)));
+typedef int32_t i32x8 __attribute__((ext_vector_type(8)));
+typedef float f32x8 __attribute__((ext_vector_type(8)));
+
+// Number of fractional bits of the fixed point conversion matrix.
+#define MATRIX_BITS 16
+
+// Number of entries of the lookup tables of the HDR conversion, indexed by signal and by linear light.
+#define TONE_LUT_SIZE 1024
+#define SRGB_LUT_SIZE 4096
+
+// Luminance in nits of SDR white, which HDR highlights are compressed into, and of HLG peak white.
+#define SDR_PEAK_LUMINANCE 100.0
+#define HLG_PEAK_LUMINANCE 1000.0
+
+/// Fixed point conversion from YUV samples of one bit depth, color space and range to 8 bit RGB.
+typedef struct {
+  int32_t yOffset;
+  int32_t cOffset;
+  int32_t y;
+  int32_t rv;
+  int32_t gu;
+  int32_t gv;
+  int32_t bu;
+} Matrix;
+
+/// A frame reduced to the thumbnail size, one sample per plane and pixel, still at the bit depth of the frame.
+typedef struct {
+  int width;
+  int height;
+  uint16_t *y;
+  uint16_t *u;
+  uint16_t *v;
+} Planes;
+
+/// Adds the samples of a row of a plane to the column sums.
+typedef void (*AccumulateRow)(uint32_t *sums, const uint8_t *row, int width);
+
+// MARK: - Scalar reference
+
+static void accumulateRow8Scalar(uint32_t *sums, const uint8_t *row, int width)
+{
+#pragma clang loop vectorize(disable)
+  for (int x = 0; x < width; x++) {
+    sums[x] += row[x];
+  }
+}
+
+static void accumulateRow16Scalar(uint32_t *sums, const uint8_t *row, int width)
+{
+  const uint16_t *samples = (const uint16_t *)row;
+#pragma clang loop vectorize(disable)
+  for (int x = 0; x < width; x++) {
+    sums[x] += samples[x];
+  }
+}
+
+static inline uint8_t clampToByte(int32_t value)
+{
+  return value < 0 ? 0 : (value > 255 ? 255 : (uint8_t)value);
+}
+
+static inline void convertPixel(const Planes *planes, const Matrix *m, int i, uint8_t *out)
+{
+  const int32_t luma = (planes->y[i] - m->yOffset) * m->y + (1 << (MATRIX_BITS - 1));
+  const int32_t u = planes->u[i] - m->cOffset;
+  const int32_t v = planes->v[i] - m->cOffset;
+  out[0] = clampToByte((luma + m->rv * v) >> MATRIX_BITS);
+  out[1] = clampToByte((luma - m->gu * u - m->gv * v) >> MATRIX_BITS);
+  out[2] = clampToByte((luma + m->bu * u) >> MATRIX_BITS);
+  out[3] = 255;
+}
+
+static void convertScalar(const Planes *planes, const Matrix *m, uint8_t *dst, int dstStride)
+{
+  for (int y = 0; y < planes->height; y++) {
+    uint8_t *out = dst + (ptrdiff_t)y * dstStride;
+#pragma clang loop vectorize(disable)
+    for (int x = 0; x < planes->width; x++) {
+      convertPixel(planes, m, y * planes->width + x, out + 4 * x);
+    }
+  }
+}
+
+// MARK: - Vector
+
+// The row accumulation reads every sample of the frame and is where nearly all the time goes. It is compiled once for
+// the baseline instruction set of the target and, on Intel, once more for AVX2, which is selected at run time.
+#define DEFINE_ACCUMULATE_ROW(name, attributes, sampleType, vectorType) \
+static attributes void name(uint32_t *sums, const uint8_t *row, int width) \
+{ \
+  const sampleType *samples = (const sampleType *)row; \
+  int x = 0; \
+  for (; x + 8 <= width; x += 8) { \
+    vectorType in; \
+    u32x8 sum; \
+    memcpy(&in, samples + x, sizeof(in)); \
+    memcpy(&sum, sums + x, sizeof(sum)); \
+    sum += __builtin_convertvector(in, u32x8); \
+    memcpy(sums + x, &sum, sizeof(sum)); \
+  } \
+  for (; x < width; x++) { \
+    sums[x] += samples[x]; \
+  } \
+}
+
+DEFINE_ACCUMULATE_ROW(accumulateRow8Vector, , uint8_t, u8x8)
+DEFINE_ACCUMULATE_ROW(accumulateRow16Vector, , uint16_t, u16x8)
+#if defined(__x86_64__)
+DEFINE_ACCUMULATE_ROW(accumulateRow8AVX2, __attribute__((target("avx2"))), uint8_t, u8x8)
+DEFINE_ACCUMULATE_ROW(accumulateRow16AVX2, __attribute__((target("avx2"))), uint16_t, u16x8)
+
+static bool hasAVX2(void)
+{
+  static int supported = -1;
+  if (supported < 0) {
+    int value = 0;
+    size_t size = sizeof(value);
+    supported = sysctlbyname("hw.optional.avx2_0", &value, &size, NULL, 0) == 0 && value;
+  }
+  return supported;
+}
+#endif
+
+/// Clamps every lane to `0...255` using only bit operations.
+static inline i32x8 clampVector(i32x8 value)
+{
+  value &= ~(value >> 31);
+  const i32x8 over = (255 - value) >> 31;
+  return (value & ~over) | (255 & over);
+}
+
+static void convertVector(const Planes *planes, const Matrix *m, uint8_t *dst, int dstStride)
+{
+  for (int y = 0; y < planes->height; y++) {
+    uint8_t *out = dst + (ptrdiff_t)y * dstStride;
+    const int row = y * planes->width;
+    int x = 0;
+    for (; x + 8 <= planes->width; x += 8) {
+      u16x8 ys, us, vs;
+      memcpy(&ys, planes->y + row + x, sizeof(ys));
+      memcpy(&us, planes->u + row + x, sizeof(us));
+      memcpy(&vs, planes->v + row + x, sizeof(vs));
+      const i32x8 luma = (__builtin_convertvector(ys, i32x8) - m->yOffset) * m->y + (1 << (MATRIX_BITS - 1));
+      const i32x8 u = __builtin_convertvector(us, i32x8) - m->cOffset;
+      const i32x8 v = __builtin_convertvector(vs, i32x8) - m->cOffset;
+      const i32x8 r = clampVector((luma + m->rv * v) >> MATRIX_BITS);
+      const i32x8 g = clampVector((luma - m->gu * u - m->gv * v) >> MATRIX_BITS);
+      const i32x8 b = clampVector((luma + m->bu * u) >> MATRIX_BITS);
+      for (int k = 0; k < 8; k++) {
+        uint8_t *pixel = out + 4 * (x + k);
+        pixel[0] = (uint8_t)r[k];
+        pixel[1] = (uint8_t)g[k];
+        pixel[2] = (uint8_t)b[k];
+        pixel[3] = 255;
+      }
+    }
+    for (; x < planes->width; x++) {
+      convertPixel(planes, m, row + x, out + 4 * x);
+    }
+  }
+}
+
+// MARK: - Kernel
+
+static AccumulateRow accumulateRowFunction(int depth, bool vector)
+{
+  if (!vector) {
+    return depth > 8 ? accumulateRow16Scalar : accumulateRow8Scalar;
+  }
+#if defined(__x86_64__)
+  if (hasAVX2()) {
+    return depth > 8 ? accumulateRow16AVX2 : accumulateRow8AVX2;
+  }
+#endif
+  return depth > 8 ? accumulateRow16Vector : accumulateRow8Vector;
+}
+
+/// Reduces a plane to the given size by averaging the samples covered by each destination sample.
+///
+/// The rows covered by a destination row are first summed per column, which is the part that is vectorized, then the
+/// columns covered by each destination sample are summed.
+static void downscalePlane(const uint8_t *src, int srcStride, int srcWidth, int srcHeight, AccumulateRow accumulate,
+                           uint16_t *dst, int dstWidth, int dstHeight, uint32_t *sums)
+{
+  for (int dy = 0; dy < dstHeight; dy++) {
+    const int y0 = (int)((int64_t)dy * srcHeight / dstHeight);
+    int y1 = (int)((int64_t)(dy + 1) * srcHeight / dstHeight);
+    if (y1 <= y0) y1 = y0 + 1;
+    memset(sums, 0, sizeof(uint32_t) * srcWidth);
+    for (int y = y0; y < y1; y++) {
+      accumulate(sums, src + (ptrdiff_t)y * srcStride, srcWidth);
+    }
+    for (int dx = 0; dx < dstWidth; dx++) {
+      const int x0 = (int)((int64_t)dx * srcWidth / dstWidth);
+      int x1 = (int)((int64_t)(dx + 1) * srcWidth / dstWidth);
+      if (x1 <= x0) x1 = x0 + 1;
+      uint32_t sum = 0;
+      for (int x = x0; x < x1; x++) {
+        sum += sums[x];
+      }
+      const uint32_t count = (uint32_t)((x1 - x0) * (y1 - y0));
+      dst[dy * dstWidth + dx] = (uint16_t)((sum + count / 2) / count);
+    }
+  }
+}
+
+/// Returns the luma coefficients of red and blue for the color space of the frame.
+static void lumaCoefficients(const AVFrame *frame, double *kr, double *kb)
+{
+  switch (frame->colorspace) {
+    case AVCOL_SPC_BT2020_NCL:
+    case AVCOL_SPC_BT2020_CL:
+      *kr = 0.2627;
+      *kb = 0.0593;
+      break;
+    case AVCOL_SPC_BT709:
+      *kr = 0.2126;
+      *kb = 0.0722;
+      break;
+    case AVCOL_SPC_BT470BG:
+    case AVCOL_SPC_SMPTE170M:
+      *kr = 0.299;
+      *kb = 0.114;
+      break;
+    default:
+      // Unspecified, assume HD video uses BT.709 and SD video BT.601 as players commonly do.
+      *kr = frame->height >= 720 ? 0.2126 : 0.299;
+      *kb = frame->height >= 720 ? 0.0722 : 0.114;
+  }
+}
+
+/// Returns the conversion matrix for the color space and range of the frame.
+static Matrix matrixForFrame(const AVFrame *frame, int depth)
+{
+  double kr, kb;
+  lumaCoefficients(frame, &kr, &kb);
+  const bool fullRange = frame->color_range == AVCOL_RANGE_JPEG || frame->format == AV_PIX_FMT_YUVJ420P;
+  const double kg = 1 - kr - kb;
+  const int shift = 1 << (depth - 8);
+  const double yScale = fullRange ? 1 : 255.0 / 219;
+  const double cScale = fullRange ? 1 : 255.0 / 224;
+  // One unit of the matrix, scaled so samples of any bit depth produce 8 bit results.
+  const double unit = (double)(1 << MATRIX_BITS) / shift;
+  Matrix m;
+  m.yOffset = fullRange ? 0 : 16 * shift;
+  m.cOffset = 128 * shift;
+  m.y = (int32_t)lround(yScale * unit);
+  m.rv = (int32_t)lround(2 * (1 - kr) * cScale * unit);
+  m.gu = (int32_t)lround(2 * kb * (1 - kb) / kg * cScale * unit);
+  m.gv = (int32_t)lround(2 * kr * (1 - kr) / kg * cScale * unit);
+  m.bu = (int32_t)lround(2 * (1 - kb) * cScale * unit);
+  return m;
+}
+
+// MARK: - HDR
+
+/// Lookup table from a PQ or HLG signal to SDR linear light, which includes the tone mapping for one peak luminance.
+typedef struct {
+  enum AVColorTransferCharacteristic transfer;
+  double peak;
+  float values[TONE_LUT_SIZE];
+} ToneLUT;
+
+static uint8_t srgbLUT[SRGB_LUT_SIZE];
+static pthread_once_t srgbLUTOnce = PTHREAD_ONCE_INIT;
+
+// Each worker thread keeps the table of the video it is working on.
+static _Thread_local ToneLUT toneLUT;
+
+static bool isHDR(const AVFrame *frame)
+{
+  return frame->color_trc == AVCOL_TRC_SMPTE2084 || frame->color_trc == AVCOL_TRC_ARIB_STD_B67;
+}
+
+static double pqToNits(double signal)
+{
+  const double m1 = 2610.0 / 16384, m2 = 2523.0 / 4096 * 128;
+  const double c1 = 3424.0 / 4096, c2 = 2413.0 / 4096 * 32, c3 = 2392.0 / 4096 * 32;
+  const double p = pow(fmax(signal, 0), 1 / m2);
+  return 10000 * pow(fmax(p - c1, 0) / (c2 - c3 * p), 1 / m1);
+}
+
+static double nitsToPQ(double nits)
+{
+  const double m1 = 2610.0 / 16384, m2 = 2523.0 / 4096 * 128;
+  const double c1 = 3424.0 / 4096, c2 = 2413.0 / 4096 * 32, c3 = 2392.0 / 4096 * 32;
+  const double y = pow(fmax(nits, 0) / 10000, m1);
+  return pow((c1 + c2 * y) / (1 + c3 * y), m2);
+}
+
+/// Inverse of the HLG OETF, returns scene linear light in `0...1`.
+static double hlgToLinear(double signal)
+{
+  const double a = 0.17883277, b = 1 - 4 * a, c = 0.5 - a * log(4 * a);
+  return signal <= 0.5 ? signal * signal / 3 : (exp((signal - c) / a) + b) / 12;
+}
+
+/// Compresses the luminance range `0...peak` into the SDR range using the EETF of ITU-R BT.2390, in the PQ domain.
+static double toneMap(double nits, double peak)
+{
+  const double sourcePeak = nitsToPQ(peak);
+  const double e = fmin(nitsToPQ(nits) / sourcePeak, 1);
+  const double maxLum = nitsToPQ(SDR_PEAK_LUMINANCE) / sourcePeak;
+  const double ks = 1.5 * maxLum - 0.5;
+  double mapped = e;
+  if (e > ks) {
+    const double t = (e - ks) / (1 - ks), t2 = t * t, t3 = t2 * t;
+    mapped = (2 * t3 - 3 * t2 + 1) * ks + (t3 - 2 * t2 + t) * (1 - ks) + (-2 * t3 + 3 * t2) * maxLum;
+  }
+  return pqToNits(mapped * sourcePeak);
+}
+
+static void buildSRGBLUT(void)
+{
+  for (int i = 0; i < SRGB_LUT_SIZE; i++) {
+    const double linear = (double)i / (SRGB_LUT_SIZE - 1);
+    const double encoded = linear <= 0.0031308 ? 12.92 * linear : 1.055 * pow(linear, 1 / 2.4) - 0.055;
+    srgbLUT[i] = (uint8_t)lround(encoded * 255);
+  }
+}
+
+/// Returns the peak luminance of the frame from its content light level or mastering display metadata.
+static double peakLuminance(const AVFrame *frame)
+{
+  double peak = frame->color_trc == AVCOL_TRC_ARIB_STD_B67 ? HLG_PEAK_LUMINANCE : 1000;
+  if (frame->color_trc == AVCOL_TRC_SMPTE2084) {
+    const AVFrameSideData *light = av_frame_get_side_data(frame, AV_FRAME_DATA_CONTENT_LIGHT_LEVEL);
+    const AVFrameSideData *mastering = av_frame_get_side_data(frame, AV_FRAME_DATA_MASTERING_DISPLAY_METADATA);
+    if (light && ((const AVContentLightMetadata *)light->data)->MaxCLL > 0) {
+      peak = ((const AVContentLightMetadata *)light->data)->MaxCLL;
+    } else if (mastering && ((const AVMasteringDisplayMetadata *)mastering->data)->has_luminance) {
+      peak = av_q2d(((const AVMasteringDisplayMetadata *)mastering->data)->max_luminance);
+    }
+  }
+  return fmin(fmax(peak, SDR_PEAK_LUMINANCE * 1.5), 10000);
+}
+
+/// Returns the tone mapping table of the calling thread for the given frame, rebuilding it if the frame needs another one.
+static const ToneLUT *toneLUTForFrame(const AVFrame *frame)
+{
+  const double peak = peakLuminance(frame);
+  if (toneLUT.transfer == frame->color_trc && toneLUT.peak == peak) return &toneLUT;
+  for (int i = 0; i < TONE_LUT_SIZE; i++) {
+    const double signal = (double)i / (TONE_LUT_SIZE - 1);
+    // HLG is displayed by applying the system gamma of a 1000 nits display to each component, which approximates
+    // applying it to the luminance closely enough for thumbnails.
+    const double nits = frame->color_trc == AVCOL_TRC_SMPTE2084 ? pqToNits(signal) :
+        HLG_PEAK_LUMINANCE * pow(hlgToLinear(signal), 1.2);
+    toneLUT.values[i] = (float)(toneMap(nits, peak) / SDR_PEAK_LUMINANCE);
+  }
+  toneLUT.transfer = frame->color_trc;
+  toneLUT.peak = peak;
+  return &toneLUT;
+}
+
+/// Returns the matrix converting linear light from the primaries of the frame to BT.709 primaries.
+static void gamutMatrix(const AVFrame *frame, float matrix[9])
+{
+  static const float bt2020[9] = {
+    1.6605f, -0.5876f, -0.0728f,
+    -0.1246f, 1.1329f, -0.0083f,
+    -0.0182f, -0.1006f, 1.1187f,
+  };
+  static const float displayP3[9] = {
+    1.2249f, -0.2247f, 0.0f,
+    -0.0420f, 1.0419f, 0.0f,
+    -0.0197f, -0.0786f, 1.0979f,
+  };
+  static const float identity[9] = {1, 0, 0, 0, 1, 0, 0, 0, 1};
+  const float *source = frame->color_primaries == AVCOL_PRI_BT2020 ? bt2020 :
+      (frame->color_primaries == AVCOL_PRI_SMPTE432 ? displayP3 : identity);
+  memcpy(matrix, source, sizeof(float) * 9);
+}
+
+static inline int lutIndex(float value, int size)
+{
+  const int index = (int)(value * (size - 1) + 0.5f);
+  return index < 0 ? 0 : (index >= size ? size - 1 : index);
+}
+
+/// Converts HDR samples to SDR RGBA.
+///
+/// The samples are converted to nonlinear RGB, which the tone mapping table turns into SDR linear light. Then the colors
+/// are converted to BT.709 primaries and encoded for display. Everything that is expensive to calculate is in tables, and
+/// as this runs on the thumbnail rather than on the frame it adds little to the time a thumbnail takes. The arithmetic is
+/// done in vectors of eight pixels, the table lookups one component at a time.
+static void convertHDR(const Planes *planes, const AVFrame *frame, int depth, uint8_t *dst, int dstStride)
+{
+  pthread_once(&srgbLUTOnce, buildSRGBLUT);
+  const ToneLUT *lut = toneLUTForFrame(frame);
+  float gamut[9];
+  gamutMatrix(frame, gamut);
+
+  double kr, kb;
+  lumaCoefficients(frame, &kr, &kb);
+  const double kg = 1 - kr - kb;
+  const bool fullRange = frame->color_range == AVCOL_RANGE_JPEG;
+  const float shift = 1 << (depth - 8);
+  const float yOffset = fullRange ? 0 : 16 * shift;
+  const float yScale = 1 / ((fullRange ? 255 : 219) * shift);
+  const float cOffset = 128 * shift;
+  const float cScale = 1 / ((fullRange ? 255 : 224) * shift);
+  const float rv = 2 * (1 - kr), gu = 2 * kb * (1 - kb) / kg, gv = 2 * kr * (1 - kr) / kg, bu = 2 * (1 - kb);
+
+  for (int y = 0; y < planes->height; y++) {
+    uint8_t *out = dst + (ptrdiff_t)y * dstStride;
+    const int row = y * planes->width;
+    for (int x = 0; x < planes->width; x += 8) {
+      const int count = planes->width - x < 8 ? planes->width - x : 8;
+      u16x8 ys = {0}, us = {0}, vs = {0};
+      memcpy(&ys, planes->y + row + x, sizeof(uint16_t) * count);
+      memcpy(&us, planes->u + row + x, sizeof(uint16_t) * count);
+      memcpy(&vs, planes->v + row + x, sizeof(uint16_t) * count);
+      const f32x8 luma = (__builtin_convertvector(ys, f32x8) - yOffset) * yScale;
+      const f32x8 u = (__builtin_convertvector(us, f32x8) - cOffset) * cScale;
+      const f32x8 v = (__builtin_convertvector(vs, f32x8) - cOffset) * cScale;
+      const f32x8 r = luma + rv * v;
+      const f32x8 g = luma - gu * u - gv * v;
+      const f32x8 b = luma + bu * u;
+      f32x8 lr, lg, lb;
+      for (int k = 0; k < 8; k++) {
+        lr[k] = lut->values[lutIndex(r[k], TONE_LUT_SIZE)];
+        lg[k] = lut->values[lutIndex(g[k], TONE_LUT_SIZE)];
+        lb[k] = lut->values[lutIndex(b[k], TONE_LUT_SIZE)];
+      }
+      const f32x8 outR = gamut[0] * lr + gamut[1] * lg + gamut[2] * lb;
+      const f32x8 outG = gamut[3] * lr + gamut[4] * lg + gamut[5] * lb;
+      const f32x8 outB = gamut[6] * lr + gamut[7] * lg + gamut[8] * lb;
+      for (int k = 0; k < count; k++) {
+        uint8_t *pixel = out + 4 * (x + k);
+        pixel[0] = srgbLUT[lutIndex(outR[k], SRGB_LUT_SIZE)];
+        pixel[1] = srgbLUT[lutIndex(outG[k], SRGB_LUT_SIZE)];
+        pixel[2] = srgbLUT[lutIndex(outB[k], SRGB_LUT_SIZE)];
+        pixel[3] = 255;
+      }
+    }
+  }
+}
+
+bool thumbnailScalerSupportsFrame(const AVFrame *frame)
+{
+  switch (frame->format) {
+    case AV_PIX_FMT_YUV420P:
+    case AV_PIX_FMT_YUVJ420P:
+    case AV_PIX_FMT_YUV420P10LE:
+      return frame->width > 0 && frame->height > 0 && frame->data[0] && frame->data[1] && frame->data[2];
+    default:
+      return false;
+  }
+}
+
+// MARK: - Scaling
+
+/// Memory used while scaling a frame. Each worker thread keeps its own between thumbnails, so it is only allocated again when
+/// a frame needs more of it. It is freed when the thread exits.
+typedef struct {
+  uint16_t *samples;
+  size_t sampleCapacity;
+  uint32_t *sums;
+  size_t sumCapacity;
+} Scratch;
+
+static pthread_key_t scratchKey;
+static pthread_once_t scratchKeyOnce = PTHREAD_ONCE_INIT;
+
+static void freeScratch(void *value)
+{
+  Scratch *scratch = value;
+  free(scratch->samples);
+  free(scratch->sums);
+  free(scratch);
+}
+
+static void createScratchKey(void)
+{
+  pthread_key_create(&scratchKey, freeScratch);
+}
+
+/// Returns the scratch memory of the calling thread with room for the given number of samples and column sums, or `NULL` if
+/// it cannot be allocated.
+static Scratch *scratchForThread(size_t sampleCount, size_t sumCount)
+{
+  pthread_once(&scratchKeyOnce, createScratchKey);
+  Scratch *scratch = pthread_getspecific(scratchKey);
+  if (!scratch) {
+    scratch = calloc(1, sizeof(Scratch));
+    if (!scratch) return NULL;
+    if (pthread_setspecific(scratchKey, scratch) != 0) {
+      free(scratch);
+      return NULL;
+    }
+  }
+  if (scratch->sampleCapacity < sampleCount) {
+    uint16_t *samples = realloc(scratch->samples, sizeof(uint16_t) * sampleCount);
+    if (!samples) return NULL;
+    scratch->samples = samples;
+    scratch->sampleCapacity = sampleCount;
+  }
+  if (scratch->sumCapacity < sumCount) {
+    uint32_t *sums = realloc(scratch->sums, sizeof(uint32_t) * sumCount);
+    if (!sums) return NULL;
+    scratch->sums = sums;
+    scratch->sumCapacity = sumCount;
+  }
+  return scratch;
+}
+
+static int scale(const AVFrame *frame, uint8_t *dst, int dstWidth, int dstHeight, int dstStride, bool vector)
+{
+  if (!thumbnailScalerSupportsFrame(frame) || dstWidth <= 0 || dstHeight <= 0) return -1;
+  const int depth = frame->format == AV_PIX_FMT_YUV420P10LE ? 10 : 8;
+  const int chromaWidth = (frame->width + 1) >> 1;
+  const int chromaHeight = (frame->height + 1) >> 1;
+  const size_t pixels = (size_t)dstWidth * dstHeight;
+  Scratch *scratch = scratchForThread(pixels * 3, (size_t)frame->width);
+  if (!scratch) return -1;
+  uint16_t *samples = scratch->samples;
+  uint32_t *sums = scratch->sums;
+  const Planes planes = {dstWidth, dstHeight, samples, samples + pixels, samples + 2 * pixels};
+  const AccumulateRow accumulate = accumulateRowFunction(depth, vector);
+  downscalePlane(frame->data[0], frame->linesize[0], frame->width, frame->height, accumulate,
+                 planes.y, dstWidth, dstHeight, sums);
+  downscalePlane(frame->data[1], frame->linesize[1], chromaWidth, chromaHeight, accumulate,
+                 planes.u, dstWidth, dstHeight, sums);
+  downscalePlane(frame->data[2], frame->linesize[2], chromaWidth, chromaHeight, accumulate,
+                 planes.v, dstWidth, dstHeight, sums);
+  const Matrix matrix = matrixForFrame(frame, depth);
+  if (isHDR(frame)) {
+    // Floating point results depend on how the compiler schedules the arithmetic, so there is only one implementation
+    convertHDR(&planes, frame, depth, dst, dstStride);
+  } else if (vector) {
+    convertVector(&planes, &matrix, dst, dstStride);
+  } else {
+    convertScalar(&planes, &matrix, dst, dstStride);
+  }
+  return 0;
+}
+
+int thumbnailScale(const AVFrame *frame, uint8_t *dst, int dstWidth, int dstHeight, int dstStride)
+{
+  return scale(frame, dst, dstWidth, dstHeight, dstStride, true);
+}
+
+int thumbnailScaleReference(const AVFrame *frame, uint8_t *dst, int dstWidth, int dstHeight, int dstStride)
+{
+  return scale(frame, dst, dstWidth, dstHeight, dstStride, false);
+}
@@ -0,0 +1,41 @@
+//
+//  ThumbnailScaler.h
+//  iina
+//
+//  Created by agent on 10/16/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+#ifndef ThumbnailScaler_h
+#define ThumbnailScaler_h
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wdocumentation"
+#include <libavutil/frame.h>
+#pragma clang diagnostic pop
+
+/// Returns whether `thumbnailScale` supports the given frame.
+///
+/// Supported are 8 and 10 bit planar 4:2:0 frames, which is what software decoders output for nearly all videos.
+bool thumbnailScalerSupportsFrame(const AVFrame *frame);
+
+/// Downscales the frame to the thumbnail size and converts it to 8 bit RGBA.
+///
+/// The frame is first reduced to the thumbnail size by averaging the samples each thumbnail pixel covers, then the few
+/// remaining pixels are converted from YUV using a fixed point matrix chosen from the color space and range of the frame.
+/// Converting after downscaling is what makes this faster than `sws_scale`, which converts every pixel of the frame. The
+/// work is done with vector instructions of the processor running the app, the result of SDR frames is the same on every
+/// processor.
+///
+/// PQ and HLG frames are tone mapped to SDR using the mastering display and content light level metadata of the frame, and
+/// converted to BT.709 primaries, so their thumbnails do not look washed out.
+/// - Returns: `0` on success, a negative value if the frame is not supported or memory could not be allocated.
+int thumbnailScale(const AVFrame *frame, uint8_t *dst, int dstWidth, int dstHeight, int dstStride);
+
+/// Same as `thumbnailScale` without vector instructions, used to verify the results of `thumbnailScale`.
+int thumbnailScaleReference(const AVFrame *frame, uint8_t *dst, int dstWidth, int dstHeight, int dstStride);
+
+#endif /* ThumbnailScaler_h */
@@ -405,6 +405,8 @@ class TouchBarPlaySliderCell: NSSliderCell {
       NSBezierPath(roundedRect: imageRect, xRadius: 2.5, yRadius: 2.5).setClip()
       let step: CGFloat = 3
       let end = imageRect.width
+      // Partial results generated in progressive order are spread over the whole timeline.
+      let canShowPartialThumbnails = info.canShowPartialThumbnails
       var i: CGFloat = 0
       solidColor.setFill()
       while (i < end + step) {
@@ -412,7 +414,7 @@ class TouchBarPlaySliderCell: NSSliderCell {
         let dest = NSRect(x: i, y: 0, width: 2, height: imageRect.height)
         if let dur = info.videoDuration?.second,
           let image = info.getThumbnail(forSecond: percent * dur)?.image,
-          info.thumbnailsProgress >= percent {
+          canShowPartialThumbnails || info.thumbnailsProgress >= percent {
           let orig = NSRect(origin: .zero, size: image.size)
           image.draw(in: dest, from: orig, operation: .copy, fraction: 1, respectFlipped: true, hints: nil)
         } else {
@@ -0,0 +1,175 @@
+//
+//  VideoInfoProber.swift
+//  iina
+//
+//  Created by agent on 10/16/26.
+//  Copyright © 2026 agent. All rights reserved.
+//
+
+import Foundation
+
+fileprivate let subsystem = Logger.makeSubsystem("prober")
+
+/// Obtains the duration and metadata of many files concurrently, for the playlist.
+///
+/// Probing a file with `FFmpegController.probeVideoInfo(forFile:)` mostly waits for the file to be read, which for files on
+/// network storage can take a long time. Files are therefore probed on a pool of operation queues, one for files on local
+/// volumes limited to the number of processor cores and one for files on network volumes limited to a few probes so a server
+/// is not flooded with requests. Requests for a file that is already being probed or that could not be probed are dropped.
+/// Results are collected and passed to `batchHandler` together, so the playlist is reloaded once per batch instead of once per
+/// file. Files found in `MediaInfoCache` are not probed again, and the results of probes are added to it.
+final class VideoInfoProber {
+
+  /// A probed file and the information `FFmpegController.probeVideoInfo(forFile:)` returned for it, `nil` if it failed.
+  typealias Result = (path: String, info: [AnyHashable: Any]?)
+
+  /// Called on a background queue with the results of probes that have finished since the last call.
+  var batchHandler: (([Result]) -> Void)?
+
+  /// Maximum time a result is held back waiting for more results to pass along with it.
+  private static let batchDelay: TimeInterval = 0.25
+
+  /// Number of results that are passed along without waiting for `batchDelay`.
+  private static let batchLimit = 200
+
+  /// Maximum number of files on network volumes that are probed at the same time.
+  private static let maxRemoteProbes = 4
+
+  private let queue: DispatchQueue
+  private let localQueue = OperationQueue()
+  private let remoteQueue = OperationQueue()
+
+  // The following state is only accessed on `queue`.
+  /// Files queued or being probed, with the number of the request that probes them.
+  private var inFlight: [String: Int] = [:]
+  private var requestCount = 0
+  private var failed = Set<String>()
+  private var pendingResults: [Result] = []
+  private var flushScheduled = false
+  /// Start of the probes that are in flight, and the number of files probed and found in the cache since, for the log.
+  private var startTime: CFTimeInterval = 0
+  private var probedCount = 0
+  private var cachedCount = 0
+  /// Whether the volume holding a directory is local, by directory, so volumes are only looked up once per directory.
+  private var directoryIsLocal: [String: Bool] = [:]
+
+  init(label: String) {
+    queue = DispatchQueue(label: label, qos: .utility)
+    localQueue.name = "\(label).local"
+    localQueue.qualityOfService = .utility
+    localQueue.maxConcurrentOperationCount = ProcessInfo.processInfo.activeProcessorCount
+    remoteQueue.name = "\(label).remote"
+    remoteQueue.qualityOfService = .utility
+    remoteQueue.maxConcurrentOperationCount = VideoInfoProber.maxRemoteProbes
+  }
+
+  /// Probe the given files, skipping files that are already being probed or failed to be probed before.
+  func probe(_ paths: [String]) {
+    queue.async { [self] in
+      for path in paths where inFlight[path] == nil && !failed.contains(path) {
+        if inFlight.isEmpty {
+          startTime = CACurrentMediaTime()
+        }
+        requestCount += 1
+        let request = requestCount
+        inFlight[path] = request
+        let operation = BlockOperation { [weak self] in
+          if let info = MediaInfoCache.shared.info(forFile: path) {
+            self?.queue.async { self?.finish(path, request: request, info, cached: true) }
+            return
+          }
+          let info = FFmpegController.probeVideoInfo(forFile: path)
+          if let info = info {
+            MediaInfoCache.shared.store(info, forFile: path)
+          }
+          self?.queue.async { self?.finish(path, request: request, info, cached: false) }
+        }
+        // A probe cancelled before it started never reports, forget it so the file can be probed again
+        operation.completionBlock = { [weak self, weak operation] in
+          guard operation?.isCancelled == true else { return }
+          self?.queue.async { self?.abandon(path, request: request) }
+        }
+        let operationQueue = isOnLocalVolume(path) ? localQueue : remoteQueue
+        operationQueue.addOperation(operation)
+      }
+    }
+  }
+
+  /// Drop the probes that have not started yet and forget the files that failed to be probed.
+  ///
+  /// Probes that are running still finish and are reported. Their files are not probed again in the meantime.
+  func cancelAll() {
+    localQueue.cancelAllOperations()
+    remoteQueue.cancelAllOperations()
+    queue.async { [self] in
+      failed.removeAll()
+    }
+  }
+
+  // MARK: - Private
+
+  private func finish(_ path: String, request: Int, _ info: [AnyHashable: Any]?, cached: Bool) {
+    guard inFlight[path] == request else { return }
+    inFlight[path] = nil
+    if info == nil {
+      failed.insert(path)
+    }
+    if cached {
+      cachedCount += 1
+    } else {
+      probedCount += 1
+    }
+    pendingResults.append((path, info))
+    if inFlight.isEmpty {
+      logCounts()
+    }
+    if pendingResults.count >= VideoInfoProber.batchLimit || inFlight.isEmpty {
+      flush()
+    } else if !flushScheduled {
+      flushScheduled = true
+      queue.asyncAfter(deadline: .now() + VideoInfoProber.batchDelay) { [weak self] in
+        self?.flush()
+      }
+    }
+  }
+
+  /// Forget a probe that was cancelled before it started.
+  private func abandon(_ path: String, request: Int) {
+    guard inFlight[path] == request else { return }
+    inFlight[path] = nil
+    if inFlight.isEmpty {
+      logCounts()
+      flush()
+    }
+  }
+
+  private func logCounts() {
+    Logger.log("Obtained info of \(probedCount + cachedCount) files, \(cachedCount) from the cache, took \(String(format: "%.2f", (CACurrentMediaTime() - startTime) * 1000))ms",
+               subsystem: subsystem)
+    if probedCount > 0 {
+      Logger.log("Probe statistics: \(FFmpegController.probeStatistics())", subsystem: subsystem)
+    }
+    probedCount = 0
+    cachedCount = 0
+  }
+
+  private func flush() {
+    flushScheduled = false
+    guard !pendingResults.isEmpty else { return }
+    let results = pendingResults
+    pendingResults.removeAll()
+    batchHandler?(results)
+  }
+
+  private func isOnLocalVolume(_ path: String) -> Bool {
+    let directory = (path as NSString).deletingLastPathComponent
+    if let isLocal = directoryIsLocal[directory] {
+      return isLocal
+    }
+    // Streams and files whose volume cannot be determined are treated like files on network volumes
+    let url = URL(fileURLWithPath: directory, isDirectory: true)
+    let isLocal = (try? url.resourceValues(forKeys: [.volumeIsLocalKey]))?.volumeIsLocal ?? false
+    directoryIsLocal[directory] = isLocal
+    return isLocal
+  }
+}